@@ -0,0 +1,67 @@
+#include "core/Lexer.h"
+#include "core/Parser.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+// Evaluates one formula over many rows where a fraction of rows divide by zero,
+// comparing the throwing API against tryEvaluate with both numeric policies
+int main() {
+    constexpr size_t ROWS = 2000000;
+    Lexer lexer("(a * 3 + b) / (b - c) + a % 7");
+    Parser parser(lexer.tokenize());
+    auto expr = parser.parse();
+
+    std::printf("errors: %zu rows of %s\n", ROWS, expr->toString().c_str());
+    for (double errorRate : {0.0, 0.01, 0.10}) {
+        // b == c makes the divisor zero
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<double> uni(0.0, 1.0);
+        std::vector<double> as(ROWS), bs(ROWS), cs(ROWS);
+        for (size_t i = 0; i < ROWS; ++i) {
+            as[i] = uni(rng) * 100;
+            bs[i] = uni(rng) * 100;
+            cs[i] = uni(rng) < errorRate ? bs[i] : bs[i] + 1 + uni(rng);
+        }
+
+        VarContext context{{"a", 0}, {"b", 0}, {"c", 0}};
+        double& a = context["a"];
+        double& b = context["b"];
+        double& c = context["c"];
+
+        auto run = [&](const char* label, auto&& evalRow) {
+            size_t failures = 0;
+            double sum = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < ROWS; ++i) {
+                a = as[i];
+                b = bs[i];
+                c = cs[i];
+                evalRow(sum, failures);
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::printf("  %4.0f%% errors  %-22s %7.1f ns/row  (%zu errors, sum %.6g)\n",
+                        errorRate * 100, label, elapsed.count() * 1e9 / ROWS, failures, sum);
+        };
+
+        run("evaluate + catch", [&](double& sum, size_t& failures) {
+            try {
+                sum += expr->evaluate(context);
+            } catch (const std::runtime_error&) {
+                ++failures;
+            }
+        });
+        run("tryEvaluate (strict)", [&](double& sum, size_t& failures) {
+            EvalResult r = expr->tryEvaluate(context);
+            if (r.ok()) sum += r.value; else ++failures;
+        });
+        run("tryEvaluate (IEEE)", [&](double& sum, size_t& failures) {
+            EvalResult r = expr->tryEvaluate(context, NumericPolicy::IEEE);
+            if (std::isfinite(r.value)) sum += r.value; else ++failures;
+        });
+    }
+    return 0;
+}
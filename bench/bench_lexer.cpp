@@ -0,0 +1,63 @@
+#include "core/Lexer.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+// Synthetic formula dump: one assignment per line. `wide` pads with column
+// alignment and long generated names, where run scanning dominates.
+static std::string makeInput(size_t bytes, bool wide) {
+    static const char* const ops[] = {" + ", " - ", " * ", " / ", " ** ", " & ", " | ", " << ", " >> "};
+    std::mt19937 rng(7);
+    std::string out;
+    out.reserve(bytes + 256);
+    while (out.size() < bytes) {
+        const std::string pad = wide ? std::string(24, ' ') : " ";
+        const std::string prefix = wide ? "normalized_calibrated_channel_measurement_" : "sensor_reading_";
+        out += "result_" + std::to_string(rng() % 1000) + pad + "=" + pad;
+        int terms = 2 + rng() % 6;
+        for (int t = 0; t < terms; ++t) {
+            if (t) out += pad + ops[rng() % 9] + pad;
+            switch (rng() % 4) {
+                case 0: out += prefix + std::to_string(rng() % 100); break;
+                case 1: out += std::to_string(rng()); break;
+                case 2: out += std::to_string(rng() % 1000) + "." + std::to_string(rng() % 100000); break;
+                default: out += "(   coefficient_" + std::to_string(rng() % 50) + "   )"; break;
+            }
+        }
+        out += "\n";
+    }
+    return out;
+}
+
+int main() {
+    for (bool wide : {false, true}) {
+        const std::string input = makeInput(64u << 20, wide);
+
+        std::printf("lexer (%s lines): %.1f MB input\n", wide ? "wide" : "compact", input.size() / 1e6);
+        for (ScanBackend b : {ScanBackend::Scalar, ScanBackend::SSE42, ScanBackend::AVX2}) {
+            if (!isScanBackendSupported(b)) {
+                std::printf("  %-8s unsupported on this CPU\n", scanBackendName(b));
+                continue;
+            }
+            // Each line is lexed on its own, the way formula files are loaded
+            double best = 1e30;
+            size_t tokenCount = 0;
+            for (int rep = 0; rep < 3; ++rep) {
+                tokenCount = 0;
+                auto start = std::chrono::steady_clock::now();
+                for (size_t lineStart = 0; lineStart < input.size();) {
+                    size_t lineEnd = input.find('\n', lineStart);
+                    if (lineEnd == std::string::npos) lineEnd = input.size();
+                    Lexer lexer(input.substr(lineStart, lineEnd - lineStart), b);
+                    tokenCount += lexer.tokenize().size();
+                    lineStart = lineEnd + 1;
+                }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                if (elapsed.count() < best) best = elapsed.count();
+            }
+            std::printf("  %-8s %7.3f GB/s  (%zu tokens)\n", scanBackendName(b), input.size() / best / 1e9, tokenCount);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "core/Lexer.h"
+#include "core/Loader.h"
+#include "core/Parser.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+
+// 1M-line formula file: a block of constants, then mostly independent
+// derived values with occasional chains through shared accumulators
+static std::string makeFile(size_t lines) {
+    std::mt19937 rng(11);
+    std::string text;
+    for (int i = 0; i < 100; ++i) {
+        text += "k" + std::to_string(i) + " = " + std::to_string(rng() % 1000) + "." + std::to_string(rng() % 100) + "\n";
+    }
+    for (size_t i = 100; i < lines; ++i) {
+        std::string a = "k" + std::to_string(rng() % 100);
+        std::string b = "k" + std::to_string(rng() % 100);
+        if (rng() % 50 == 0) {
+            std::string acc = "acc" + std::to_string(rng() % 8);
+            text += acc + " = " + a + " * 2 + " + std::to_string(i % 97) + "\n";
+        } else {
+            text += "row" + std::to_string(i) + " = (" + a + " + " + b + ") * " + std::to_string(i % 13) +
+                    " - (" + a + " << 2) / (" + b + " + 1)\n";
+        }
+    }
+    return text;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main() {
+    constexpr size_t LINES = 1000000;
+    const std::string text = makeFile(LINES);
+    std::printf("loader: %zu lines, %.1f MB\n", LINES, text.size() / 1e6);
+
+    // Baseline: the REPL's one-line-at-a-time loop
+    {
+        auto start = std::chrono::steady_clock::now();
+        VarContext context;
+        size_t ok = 0;
+        for (size_t pos = 0; pos < text.size();) {
+            size_t end = text.find('\n', pos);
+            if (end == std::string::npos) end = text.size();
+            Lexer lexer(text.substr(pos, end - pos));
+            Parser parser(lexer.tokenize());
+            parser.parse()->evaluate(context);
+            ++ok;
+            pos = end + 1;
+        }
+        std::printf("  serial loop      %8.3f s  (%zu statements)\n", secondsSince(start), ok);
+    }
+
+    unsigned hw = std::thread::hardware_concurrency();
+    if (hw == 0) hw = 1;
+    double base = 0.0;
+    for (unsigned threads = 1; threads <= hw; threads = (threads * 2 > hw && threads != hw) ? hw : threads * 2) {
+        Loader loader(threads);
+        VarContext context;
+
+        auto start = std::chrono::steady_clock::now();
+        auto statements = loader.parse(text);
+        double parseTime = secondsSince(start);
+        auto evalStart = std::chrono::steady_clock::now();
+        auto results = loader.evaluate(statements, context);
+        double evalTime = secondsSince(evalStart);
+        double total = parseTime + evalTime;
+        if (threads == 1) base = total;
+
+        std::printf("  loader %2u threads %8.3f s  (parse %.3f, evaluate %.3f, speedup %.2fx, %zu results)\n",
+                    threads, total, parseTime, evalTime, base / total, results.size());
+    }
+    return 0;
+}
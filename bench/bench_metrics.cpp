@@ -0,0 +1,98 @@
+#include "core/Lexer.h"
+#include "core/Metrics.h"
+#include "core/Parser.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Cost of the metrics hooks: the full lex/parse/evaluate pipeline and
+// evaluation of a pre-parsed AST, with metrics off, on (sampled every 256th
+// call, the default) and on with every call timed. The modes run back to back
+// in short bursts; each trial compares them against the "off" burst next to
+// it, and the median over all trials is reported, so machine noise that drifts
+// over the run cancels out.
+using Clock = std::chrono::steady_clock;
+
+static const char* FORMULAS[] = {
+    "x = 3 * (y + 2)",
+    "x > y ? x - y : (y - x) / 2",
+    "(x << 2) | (y & 255)",
+    "x ** 2 + y ** 2 - 2 * x * y",
+};
+
+template <typename Fn>
+static double nsPerOp(size_t ops, Fn fn) {
+    auto start = Clock::now();
+    fn();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ops;
+}
+
+static double median(std::vector<double> values) {
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+int main() {
+    constexpr size_t TRIALS = 201;
+    constexpr size_t PIPELINE_ROUNDS = 500;
+    constexpr size_t EVAL_ROUNDS = 10000;
+    constexpr size_t N = sizeof(FORMULAS) / sizeof(FORMULAS[0]);
+
+    std::vector<std::unique_ptr<Expr>> asts;
+    for (const char* f : FORMULAS) {
+        Lexer lexer(f);
+        Parser parser(lexer.tokenize());
+        asts.push_back(parser.parse());
+    }
+
+    double sink = 0;
+    auto pipeline = [&] {
+        VarContext context{{"x", 1}, {"y", 2}};
+        for (size_t r = 0; r < PIPELINE_ROUNDS; ++r) {
+            for (const char* f : FORMULAS) {
+                Lexer lexer(f);
+                Parser parser(lexer.tokenize());
+                sink += parser.parse()->tryEvaluate(context).value;
+            }
+        }
+    };
+    auto evaluate = [&] {
+        VarContext context{{"x", 1}, {"y", 2}};
+        for (size_t r = 0; r < EVAL_ROUNDS; ++r) {
+            for (const auto& ast : asts) sink += ast->tryEvaluate(context).value;
+        }
+    };
+
+    struct Mode {
+        const char* label;
+        bool enabled;
+        uint32_t interval;
+        std::vector<double> pipeline, eval;                // ns per operation, one per trial
+        std::vector<double> pipelineRatio, evalRatio;      // against the same trial's "off"
+    };
+    Mode modes[] = {{"off", false, 256, {}, {}, {}, {}}, {"on (1/256)", true, 256, {}, {}, {}, {}},
+                    {"on (all)", true, 1, {}, {}, {}, {}}};
+
+    for (size_t trial = 0; trial < TRIALS; ++trial) {
+        for (Mode& mode : modes) {
+            Metrics::setEnabled(mode.enabled);
+            Metrics::setSampleInterval(mode.interval);
+            mode.pipeline.push_back(nsPerOp(PIPELINE_ROUNDS * N, pipeline));
+            mode.eval.push_back(nsPerOp(EVAL_ROUNDS * N, evaluate));
+            mode.pipelineRatio.push_back(mode.pipeline.back() / modes[0].pipeline.back());
+            mode.evalRatio.push_back(mode.eval.back() / modes[0].eval.back());
+        }
+    }
+
+    std::printf("metrics overhead: %zu formulas, median of %zu trials\n", N, TRIALS);
+    for (const Mode& mode : modes) {
+        std::printf("  %-10s  lex+parse+eval %7.1f ns (%+5.1f%%)   eval only %6.1f ns (%+5.1f%%)\n", mode.label,
+                    median(mode.pipeline), (median(mode.pipelineRatio) - 1) * 100, median(mode.eval),
+                    (median(mode.evalRatio) - 1) * 100);
+    }
+    Metrics::setEnabled(false);
+    Metrics::setSampleInterval(256);
+    return sink == 0.123 ? 1 : 0;
+}
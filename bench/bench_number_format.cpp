@@ -0,0 +1,82 @@
+#include "core/NumberFormat.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Formatting used by Token/NumberNode before the switch to shortest round-trip
+static std::string legacyFormat(double value) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(6) << value;
+    std::string s = oss.str();
+    s.erase(s.find_last_not_of('0') + 1, std::string::npos);
+    if (!s.empty() && s.back() == '.') s.pop_back();
+    return s;
+}
+
+template <typename F>
+static double secondsFor(F&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main() {
+    constexpr size_t N = 1000000;
+
+    // Mix of "calculator" values and arbitrary finite bit patterns
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> dist(-1e6, 1e6);
+    std::vector<double> values;
+    values.reserve(N);
+    while (values.size() < N) {
+        if (values.size() % 2 == 0) {
+            values.push_back(dist(rng));
+        } else {
+            uint64_t bits = rng();
+            double v;
+            std::memcpy(&v, &bits, sizeof(v));
+            if (std::isfinite(v)) values.push_back(v);
+        }
+    }
+
+    size_t sink = 0;
+    double legacy = secondsFor([&] {
+        for (double v : values) sink += legacyFormat(v).size();
+    });
+
+    std::vector<std::string> texts;
+    texts.reserve(N);
+    double fast = secondsFor([&] {
+        char buf[NUMBER_BUFFER_SIZE];
+        for (double v : values) {
+            char* end = formatNumber(v, buf, buf + sizeof(buf));
+            sink += end - buf;
+        }
+    });
+    for (double v : values) texts.push_back(formatNumber(v));
+
+    double parseStrtod = secondsFor([&] {
+        for (const auto& t : texts) sink += std::strtod(t.c_str(), nullptr) != 0;
+    });
+    double parseFast = secondsFor([&] {
+        double out;
+        for (const auto& t : texts) sink += parseNumber(t.data(), t.data() + t.size(), out);
+    });
+
+    std::printf("number format: %zu values\n", N);
+    std::printf("  ostringstream fixed(6)  %10.2f M outputs/s\n", N / legacy / 1e6);
+    std::printf("  formatNumber (to_chars) %10.2f M outputs/s\n", N / fast / 1e6);
+    std::printf("  std::strtod             %10.2f M parses/s\n", N / parseStrtod / 1e6);
+    std::printf("  parseNumber (from_chars)%10.2f M parses/s\n", N / parseFast / 1e6);
+    std::printf("  (checksum %zu)\n", sink);
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "core/Sandbox.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// Untrusted traffic: mostly ordinary formulas with a few hostile ones mixed in
+static std::vector<std::string> makeWorkload(size_t count) {
+    std::mt19937 rng(5);
+    std::string deepParens = std::string(100000, '(') + "1" + std::string(100000, ')');
+    std::string unaryChain = std::string(100000, '-') + "1";
+    std::string longSum = "1";
+    for (int i = 0; i < 30000; ++i) longSum += "+x";
+    std::string powerChain = "2";
+    for (int i = 0; i < 5000; ++i) powerChain += "**2";
+
+    std::vector<std::string> out;
+    for (size_t i = 0; i < count; ++i) {
+        if (rng() % 100 == 0) {
+            const std::string* hostile[] = {&deepParens, &unaryChain, &longSum, &powerChain};
+            out.push_back(*hostile[rng() % 4]);
+        } else {
+            out.push_back("y = (x * " + std::to_string(rng() % 100) + " + 3.5) / (x - " +
+                          std::to_string(rng() % 7 + 20) + ") << 2");
+        }
+    }
+    return out;
+}
+
+int main() {
+    const auto workload = makeWorkload(20000);
+    Sandbox sandbox;
+
+    std::vector<double> latenciesUs;
+    latenciesUs.reserve(workload.size());
+    size_t rejected = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& formula : workload) {
+        VarContext context{{"x", 4.0}};
+        auto t0 = std::chrono::steady_clock::now();
+        try {
+            sandbox.evaluate(formula, context);
+        } catch (const SandboxError&) {
+            ++rejected;
+        }
+        std::chrono::duration<double, std::micro> dt = std::chrono::steady_clock::now() - t0;
+        latenciesUs.push_back(dt.count());
+    }
+    std::chrono::duration<double> total = std::chrono::steady_clock::now() - start;
+
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+    auto pct = [&](double p) { return latenciesUs[static_cast<size_t>(p * (latenciesUs.size() - 1))]; };
+    std::printf("sandbox: %zu formulas (%zu rejected by limits)\n", workload.size(), rejected);
+    std::printf("  throughput %10.0f formulas/s\n", workload.size() / total.count());
+    std::printf("  latency    p50 %.1f us  p99 %.1f us  max %.1f us\n", pct(0.50), pct(0.99), latenciesUs.back());
+    return 0;
+}
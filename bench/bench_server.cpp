@@ -0,0 +1,83 @@
+#include "core/Server.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Load generator for server mode: client threads each keep `depth` requests in
+// flight over their own connection. Latency is measured from sending a batch of
+// frames to receiving each reply.
+using Clock = std::chrono::steady_clock;
+
+static const char* FORMULAS[] = {
+    "x = x + 1",
+    "x * 2 + y",
+    "x > y ? x - y : y - x",
+    "(x & 255) << 2 | y",
+};
+
+static void runLoad(const char* label, const ServerOptions& base, unsigned clients, unsigned depth, size_t perClient) {
+    ServerOptions options = base;
+    Server server(options);
+    server.listen();
+    std::thread loop([&] { server.run(); });
+
+    std::vector<std::vector<double>> latencies(clients);
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            ServerClient client(options.socketPath);
+            client.eval("x = 1");
+            client.eval("y = 2");
+
+            std::string frames;
+            std::vector<double>& lat = latencies[c];
+            lat.reserve(perClient);
+            for (size_t done = 0; done < perClient; done += depth) {
+                frames.clear();
+                for (unsigned k = 0; k < depth; ++k) {
+                    appendRequest(frames, ServerOp::Eval, FORMULAS[(done + k) % 4]);
+                }
+                auto sent = Clock::now();
+                client.send(frames);
+                for (unsigned k = 0; k < depth; ++k) {
+                    client.receive();
+                    lat.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    server.stop();
+    loop.join();
+
+    std::vector<double> all;
+    for (auto& lat : latencies) all.insert(all.end(), lat.begin(), lat.end());
+    std::sort(all.begin(), all.end());
+    auto pct = [&](double p) { return all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))]; };
+    std::printf("  %-9s clients %2u  depth %3u   %9.0f req/s   p50 %7.1f us   p99 %7.1f us\n", label, clients,
+                depth, all.size() / elapsed.count(), pct(0.50), pct(0.99));
+}
+
+int main() {
+    ServerOptions options;
+    options.socketPath = "/tmp/mini_expr_bench_" + std::to_string(::getpid()) + ".sock";
+    options.threads = 1;
+
+    ServerOptions uncached = options;
+    uncached.cacheCapacity = 0;
+
+    std::printf("server: Unix socket, %zu-formula mix\n", sizeof(FORMULAS) / sizeof(FORMULAS[0]));
+    for (unsigned clients : {1u, 8u}) {
+        for (unsigned depth : {1u, 32u}) {
+            runLoad("cached", options, clients, depth, 20000);
+        }
+    }
+    runLoad("uncached", uncached, 8, 32, 20000);
+    return 0;
+}
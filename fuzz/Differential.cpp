@@ -0,0 +1,906 @@
+#include "Differential.h"
+#include "core/Aggregate.h"
+#include "core/Lexer.h"
+#include "core/Loader.h"
+#include "core/NumberFormat.h"
+#include "core/Parser.h"
+#include "core/Sandbox.h"
+#include "core/Scan.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+
+const char* const FUZZ_INPUTS[4] = {"x", "y", "z", "a_rather_long_identifier_to_cover_the_simd_scanners"};
+
+// Wide Loader programs repeat every statement this many times, enough for one
+// wave to take the Loader's parallel path
+constexpr size_t WIDE_REPEAT = 2100;
+
+// Values that sit on the edges of the operator semantics: signed zeros, int
+// truncation and shift-count boundaries, overflow, subnormals, inf and NaN
+static const double INTERESTING[] = {
+    0.0, -0.0, 1.0, -1.0, 2.0, 3.0, 0.5, -2.5, 7.25, 31.0, 32.0, 33.0, -33.0,
+    2147483647.0, 2147483648.0, -2147483648.0, -2147483649.0, 4294967296.0, 1e15, 1e300, -1e300, 1e-310,
+    std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+    std::numeric_limits<double>::quiet_NaN(),
+};
+constexpr size_t INTERESTING_COUNT = sizeof(INTERESTING) / sizeof(INTERESTING[0]);
+
+static const char* const LITERALS[] = {
+    "0", "1", "2", "3", "5", "7", "31", "32", "33", "0.5", "2.5", "0.1", "1e3", "2.5e-7", "1E+308", "1e-320",
+    "2147483647", "2147483648", "4294967296", "0x1F", "0x7fffffff", "0xFFFFFFFF",
+    "123456789012345678901234567890", "0000000000000000000000000000000000000042",
+};
+constexpr size_t LITERAL_COUNT = sizeof(LITERALS) / sizeof(LITERALS[0]);
+
+static const TokenType BINARY_OPS[] = {
+    TokenType::PLUS, TokenType::MINUS, TokenType::MUL, TokenType::DIV, TokenType::MOD, TokenType::POWER,
+    TokenType::BIT_AND, TokenType::BIT_OR, TokenType::BIT_XOR, TokenType::LSHIFT, TokenType::RSHIFT,
+    TokenType::LESS, TokenType::LESS_EQUAL, TokenType::GREATER, TokenType::GREATER_EQUAL,
+    TokenType::EQUAL, TokenType::NOT_EQUAL,
+};
+static const TokenType UNARY_OPS[] = {TokenType::PLUS, TokenType::MINUS, TokenType::BIT_NOT, TokenType::LOGICAL_NOT};
+
+// ---------------- ByteSource ----------------
+
+size_t ByteSource::choose(size_t n) {
+    if (n <= 1) return 0;
+    size_t v = byte();
+    if (n > 256) v = (v << 8) | byte();
+    return v % n;
+}
+
+uint32_t ByteSource::word() {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v = (v << 8) | byte();
+    return v;
+}
+
+// ---------------- Generation ----------------
+
+static GenNode leaf(GenNode::Kind kind, const std::string& text) {
+    GenNode node;
+    node.kind = kind;
+    node.text = text;
+    return node;
+}
+
+static GenNode generateNode(ByteSource& in, int depth) {
+    // Choice 0 is a literal, so exhausted input ends the tree
+    size_t kind = depth > 0 ? in.choose(10) : in.choose(2);
+    if (kind == 0) return leaf(GenNode::Kind::Number, LITERALS[in.choose(LITERAL_COUNT)]);
+    if (kind == 1) {
+        // Mostly inputs; sometimes the assigned names (which may be undefined) or `w` (always undefined)
+        size_t v = in.choose(12);
+        if (v < 8) return leaf(GenNode::Kind::Variable, FUZZ_INPUTS[v % 4]);
+        return leaf(GenNode::Kind::Variable, v < 10 ? "a" : v == 10 ? "b" : "w");
+    }
+
+    GenNode node;
+    if (kind <= 5) {
+        node.kind = GenNode::Kind::Binary;
+        node.op = BINARY_OPS[in.choose(sizeof(BINARY_OPS) / sizeof(BINARY_OPS[0]))];
+    } else if (kind == 6) {
+        node.kind = GenNode::Kind::Unary;
+        node.op = UNARY_OPS[in.choose(4)];
+    } else if (kind == 7) {
+        node.kind = GenNode::Kind::Logical;
+        node.op = in.choose(2) ? TokenType::LOGICAL_OR : TokenType::LOGICAL_AND;
+    } else {
+        node.kind = GenNode::Kind::Conditional;
+    }
+    size_t arity = node.kind == GenNode::Kind::Unary ? 1 : node.kind == GenNode::Kind::Conditional ? 3 : 2;
+    for (size_t i = 0; i < arity; ++i) node.children.push_back(generateNode(in, depth - 1));
+    return node;
+}
+
+// The grammar only allows assignments at the top of a statement (a = b = ...)
+static GenNode generateStatement(ByteSource& in) {
+    GenNode value = generateNode(in, static_cast<int>(in.choose(7)));
+    size_t targets = in.choose(4) == 0 ? 1 + in.choose(2) : 0;
+    for (size_t i = 0; i < targets; ++i) {
+        GenNode assign;
+        assign.kind = GenNode::Kind::Assignment;
+        size_t t = in.choose(3);
+        assign.text = t == 0 ? "a" : t == 1 ? "b" : "x";
+        assign.children.push_back(std::move(value));
+        value = std::move(assign);
+    }
+    return value;
+}
+
+FuzzCase generateCase(ByteSource& in) {
+    FuzzCase c;
+    size_t statements = in.choose(4) == 0 ? 2 + in.choose(3) : 1;
+    for (size_t i = 0; i < 4; ++i) c.inputs.push_back(INTERESTING[in.choose(INTERESTING_COUNT)]);
+    c.initialA = in.choose(2) == 1;
+    c.valueA = INTERESTING[in.choose(INTERESTING_COUNT)];
+    size_t rows = in.choose(32);
+    c.rows = rows < 24 ? 1 + rows % 8 : rows < 31 ? 200 + in.choose(400) : AGGREGATE_BLOCK + in.choose(600);
+    c.rowSeed = in.word();
+    c.minimalParens = in.choose(4) != 0;
+    c.spacing = in.word();
+    c.wideProgram = in.choose(32) == 0;
+    for (size_t i = 0; i < statements; ++i) c.statements.push_back(generateStatement(in));
+    return c;
+}
+
+// ---------------- Rendering ----------------
+
+static const char* opText(TokenType op) {
+    switch (op) {
+        case TokenType::PLUS:          return "+";
+        case TokenType::MINUS:         return "-";
+        case TokenType::MUL:           return "*";
+        case TokenType::DIV:           return "/";
+        case TokenType::MOD:           return "%";
+        case TokenType::POWER:         return "**";
+        case TokenType::BIT_AND:       return "&";
+        case TokenType::BIT_OR:        return "|";
+        case TokenType::BIT_XOR:       return "^";
+        case TokenType::BIT_NOT:       return "~";
+        case TokenType::LSHIFT:        return "<<";
+        case TokenType::RSHIFT:        return ">>";
+        case TokenType::LESS:          return "<";
+        case TokenType::LESS_EQUAL:    return "<=";
+        case TokenType::GREATER:       return ">";
+        case TokenType::GREATER_EQUAL: return ">=";
+        case TokenType::EQUAL:         return "==";
+        case TokenType::NOT_EQUAL:     return "!=";
+        case TokenType::LOGICAL_AND:   return "&&";
+        case TokenType::LOGICAL_OR:    return "||";
+        case TokenType::LOGICAL_NOT:   return "!";
+        default:                       return "?";
+    }
+}
+
+// Grammar levels, loosest first (see Parser.cpp): assignment, ?:, ||, &&,
+// equality, comparison, + -, * / %, |, ^, &, shifts, **, unary, primary
+static int level(const GenNode& node) {
+    switch (node.kind) {
+        case GenNode::Kind::Assignment:  return 0;
+        case GenNode::Kind::Conditional: return 1;
+        case GenNode::Kind::Logical:     return node.op == TokenType::LOGICAL_OR ? 2 : 3;
+        case GenNode::Kind::Unary:       return 13;
+        case GenNode::Kind::Number:
+        case GenNode::Kind::Variable:    return 14;
+        case GenNode::Kind::Binary:      break;
+    }
+    switch (node.op) {
+        case TokenType::EQUAL: case TokenType::NOT_EQUAL: return 4;
+        case TokenType::LESS: case TokenType::LESS_EQUAL:
+        case TokenType::GREATER: case TokenType::GREATER_EQUAL: return 5;
+        case TokenType::PLUS: case TokenType::MINUS: return 6;
+        case TokenType::MUL: case TokenType::DIV: case TokenType::MOD: return 7;
+        case TokenType::BIT_OR: return 8;
+        case TokenType::BIT_XOR: return 9;
+        case TokenType::BIT_AND: return 10;
+        case TokenType::LSHIFT: case TokenType::RSHIFT: return 11;
+        default: return 12;  // **
+    }
+}
+
+// Appends the tokens of `node`, parenthesized when its level is below `minLevel`
+// (or, without minimal parentheses, whenever it is an operation)
+static void renderTokens(const GenNode& node, int minLevel, bool minimal, std::vector<std::string>& out) {
+    bool operation = node.kind != GenNode::Kind::Number && node.kind != GenNode::Kind::Variable &&
+                     node.kind != GenNode::Kind::Assignment;
+    bool parens = minimal ? level(node) < minLevel : operation;
+    if (parens) out.push_back("(");
+
+    int l = level(node);
+    switch (node.kind) {
+        case GenNode::Kind::Number:
+        case GenNode::Kind::Variable:
+            out.push_back(node.text);
+            break;
+        case GenNode::Kind::Unary:
+            out.push_back(opText(node.op));
+            renderTokens(node.children[0], 13, minimal, out);
+            break;
+        case GenNode::Kind::Binary:
+        case GenNode::Kind::Logical:
+            // Left-associative, except ** whose left operand is a factor
+            renderTokens(node.children[0], l == 12 ? 13 : l, minimal, out);
+            out.push_back(opText(node.op));
+            renderTokens(node.children[1], l == 12 ? 12 : l + 1, minimal, out);
+            break;
+        case GenNode::Kind::Conditional:
+            renderTokens(node.children[0], 2, minimal, out);
+            out.push_back("?");
+            renderTokens(node.children[1], 1, minimal, out);
+            out.push_back(":");
+            renderTokens(node.children[2], 1, minimal, out);
+            break;
+        case GenNode::Kind::Assignment:
+            out.push_back(node.text);
+            out.push_back("=");
+            renderTokens(node.children[0], 0, minimal, out);
+            break;
+    }
+    if (parens) out.push_back(")");
+}
+
+static bool isWordChar(char ch) {
+    return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_' || ch == '.';
+}
+
+std::string renderStatement(const GenNode& node, bool minimalParens, uint32_t spacing) {
+    std::vector<std::string> tokens;
+    renderTokens(node, 0, minimalParens, tokens);
+
+    // Random whitespace between tokens, including runs longer than a SIMD block;
+    // a space is forced where two tokens would otherwise lex as one. Spacing 0
+    // (what reproducers are shrunk to) puts one space everywhere.
+    static const char* const GAPS[] = {"", "", " ", " ", "\t", "  \x0b ", "                                        "};
+    std::minstd_rand rng(spacing | 1);
+    std::string out;
+    for (const std::string& token : tokens) {
+        std::string gap = out.empty() ? "" : spacing == 0 ? " " : GAPS[rng() % 7];
+        if (gap.empty() && !out.empty()) {
+            std::string pair = std::string(1, out.back()) + token[0];
+            static const char* const MERGING[] = {"<<", ">>", "<=", ">=", "==", "!=", "&&", "||", "**"};
+            bool merges = isWordChar(out.back()) && isWordChar(token[0]);
+            for (const char* m : MERGING) merges |= pair == m;
+            if (merges) gap = " ";
+        }
+        out += gap;
+        out += token;
+    }
+    return out;
+}
+
+// Expr::toString of the tree the parser should build
+static std::string canonical(const GenNode& node);
+
+static double literalValue(const std::string& text) {
+    if (text.size() > 2 && (text[1] == 'x' || text[1] == 'X')) {
+        return static_cast<double>(std::strtoull(text.c_str() + 2, nullptr, 16));
+    }
+    return std::strtod(text.c_str(), nullptr);
+}
+
+static std::string canonical(const GenNode& node) {
+    switch (node.kind) {
+        case GenNode::Kind::Number:      return formatNumber(literalValue(node.text));
+        case GenNode::Kind::Variable:    return node.text;
+        case GenNode::Kind::Unary:       return std::string("(") + opText(node.op) + canonical(node.children[0]) + ")";
+        case GenNode::Kind::Conditional:
+            return "(" + canonical(node.children[0]) + " ? " + canonical(node.children[1]) + " : " +
+                   canonical(node.children[2]) + ")";
+        case GenNode::Kind::Assignment:  return node.text + " = " + canonical(node.children[0]);
+        default:
+            return "(" + canonical(node.children[0]) + " " + opText(node.op) + " " + canonical(node.children[1]) + ")";
+    }
+}
+
+// ---------------- Reference model ----------------
+// A direct restatement of the documented semantics, independent of AST.cpp:
+// operands left to right, the first error sticks and yields NaN, && || and ?:
+// short-circuit, bitwise operands truncate to int (NaN and out-of-range values
+// become INT_MIN), shift counts use their low 5 bits, failed assignments store nothing.
+
+struct ModelState {
+    NumericPolicy policy = NumericPolicy::Strict;
+    EvalError error = EvalError::None;
+    std::string variable;
+
+    double fail(EvalError e, const std::string& name = "") {
+        if (error == EvalError::None) {
+            error = e;
+            variable = name;
+        }
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+};
+
+static int32_t modelInt(double v) {
+    if (!(v > -2147483649.0 && v < 2147483648.0)) return std::numeric_limits<int32_t>::min();
+    return static_cast<int32_t>(std::trunc(v));
+}
+
+static double modelEval(const GenNode& node, VarContext& context, ModelState& state) {
+    switch (node.kind) {
+        case GenNode::Kind::Number:
+            return literalValue(node.text);
+        case GenNode::Kind::Variable: {
+            auto it = context.find(node.text);
+            return it == context.end() ? state.fail(EvalError::UndefinedVariable, node.text) : it->second;
+        }
+        case GenNode::Kind::Assignment: {
+            double v = modelEval(node.children[0], context, state);
+            if (state.error == EvalError::None) context[node.text] = v;
+            return v;
+        }
+        case GenNode::Kind::Conditional: {
+            bool cond = modelEval(node.children[0], context, state) != 0;
+            return modelEval(node.children[cond ? 1 : 2], context, state);
+        }
+        case GenNode::Kind::Logical: {
+            bool lhs = modelEval(node.children[0], context, state) != 0;
+            bool decided = node.op == TokenType::LOGICAL_AND ? !lhs : lhs;
+            if (decided) return lhs ? 1.0 : 0.0;
+            return modelEval(node.children[1], context, state) != 0 ? 1.0 : 0.0;
+        }
+        case GenNode::Kind::Unary: {
+            double v = modelEval(node.children[0], context, state);
+            switch (node.op) {
+                case TokenType::MINUS:   return -v;
+                case TokenType::BIT_NOT: return static_cast<double>(~modelInt(v));
+                case TokenType::LOGICAL_NOT: return v == 0 ? 1.0 : 0.0;
+                default:                 return v;
+            }
+        }
+        case GenNode::Kind::Binary:
+            break;
+    }
+
+    double l = modelEval(node.children[0], context, state);
+    double r = modelEval(node.children[1], context, state);
+    bool strict = state.policy == NumericPolicy::Strict;
+    uint32_t count = static_cast<uint32_t>(modelInt(r)) % 32;
+    switch (node.op) {
+        case TokenType::PLUS:  return l + r;
+        case TokenType::MINUS: return l - r;
+        case TokenType::MUL:   return l * r;
+        case TokenType::DIV:   return r == 0 && strict ? state.fail(EvalError::DivisionByZero) : l / r;
+        case TokenType::MOD:   return r == 0 && strict ? state.fail(EvalError::ModuloByZero) : std::fmod(l, r);
+        case TokenType::POWER: return std::pow(l, r);
+        case TokenType::BIT_AND: return static_cast<double>(modelInt(l) & modelInt(r));
+        case TokenType::BIT_OR:  return static_cast<double>(modelInt(l) | modelInt(r));
+        case TokenType::BIT_XOR: return static_cast<double>(modelInt(l) ^ modelInt(r));
+        case TokenType::LSHIFT:
+            return static_cast<double>(static_cast<int32_t>(static_cast<uint32_t>(modelInt(l)) << count));
+        case TokenType::RSHIFT: return static_cast<double>(modelInt(l) >> count);
+        case TokenType::LESS:          return l < r ? 1.0 : 0.0;
+        case TokenType::LESS_EQUAL:    return l <= r ? 1.0 : 0.0;
+        case TokenType::GREATER:       return l > r ? 1.0 : 0.0;
+        case TokenType::GREATER_EQUAL: return l >= r ? 1.0 : 0.0;
+        case TokenType::EQUAL:         return l == r ? 1.0 : 0.0;
+        case TokenType::NOT_EQUAL:     return l != r ? 1.0 : 0.0;
+        default:                       return state.fail(EvalError::UnknownOperator);
+    }
+}
+
+// ---------------- Comparison helpers ----------------
+
+// Bit-for-bit, except that NaN payloads are not part of the semantics
+static bool sameValue(double a, double b) {
+    if (std::isnan(a) || std::isnan(b)) return std::isnan(a) && std::isnan(b);
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+static std::string show(double v) {
+    if (std::isnan(v)) return "nan";
+    if (std::isinf(v)) return v > 0 ? "inf" : "-inf";
+    return formatNumber(v);
+}
+
+static std::string showContext(const VarContext& context) {
+    std::vector<std::string> names;
+    for (const auto& entry : context) names.push_back(entry.first);
+    std::sort(names.begin(), names.end());
+    std::string out = "{";
+    for (const std::string& name : names) {
+        if (out.size() > 1) out += ", ";
+        out += name + "=" + show(context.at(name));
+    }
+    return out + "}";
+}
+
+static bool sameContext(const VarContext& a, const VarContext& b) {
+    if (a.size() != b.size()) return false;
+    for (const auto& entry : a) {
+        auto it = b.find(entry.first);
+        if (it == b.end() || !sameValue(entry.second, it->second)) return false;
+    }
+    return true;
+}
+
+static const char* errorName(EvalError error) {
+    switch (error) {
+        case EvalError::None:              return "none";
+        case EvalError::DivisionByZero:    return "DivisionByZero";
+        case EvalError::ModuloByZero:      return "ModuloByZero";
+        case EvalError::UndefinedVariable: return "UndefinedVariable";
+        case EvalError::UnknownOperator:   return "UnknownOperator";
+    }
+    return "?";
+}
+
+static std::string showResult(const EvalResult& r) {
+    return r.ok() ? show(r.value) : "error \"" + r.message() + "\"";
+}
+
+static bool sameResult(const EvalResult& a, const EvalResult& b) {
+    return a.error == b.error && (a.ok() ? sameValue(a.value, b.value) : a.message() == b.message());
+}
+
+// Outcome of the throwing APIs in EvalResult-comparable form
+struct ThrownOutcome {
+    bool ok = false;
+    double value = 0.0;
+    std::string message;
+};
+
+template <typename Fn>
+static ThrownOutcome runThrowing(Fn fn) {
+    ThrownOutcome out;
+    try {
+        out.value = fn();
+        out.ok = true;
+    } catch (const SandboxError& ex) {
+        out.message = std::string("sandbox limit: ") + ex.what();
+    } catch (const std::runtime_error& ex) {
+        out.message = ex.what();
+    }
+    return out;
+}
+
+static std::string compareThrown(const char* check, const EvalResult& ref, const ThrownOutcome& got) {
+    bool same = got.ok == ref.ok() && (got.ok ? sameValue(got.value, ref.value) : got.message == ref.message());
+    if (same) return "";
+    return std::string("[") + check + "] tree walker " + showResult(ref) + ", " + check + " " +
+           (got.ok ? show(got.value) : "error \"" + got.message + "\"");
+}
+
+// ---------------- Checks ----------------
+
+static std::string tokenStream(const std::string& source, ScanBackend backend) {
+    try {
+        Lexer lexer(source, backend);
+        std::string out;
+        for (const Token& token : lexer.tokenize()) {
+            out += std::to_string(static_cast<int>(token.type)) + ":" + token.toString() + " ";
+        }
+        return out;
+    } catch (const std::runtime_error& ex) {
+        return std::string("error: ") + ex.what();
+    }
+}
+
+static std::string checkLexers(const std::string& source) {
+    std::string scalar = tokenStream(source, ScanBackend::Scalar);
+    for (ScanBackend backend : {ScanBackend::SSE42, ScanBackend::AVX2}) {
+        if (!isScanBackendSupported(backend)) continue;
+        std::string other = tokenStream(source, backend);
+        if (other != scalar) {
+            return std::string("[lexer] ") + scanBackendName(backend) + " tokens differ from scalar:\n    scalar: " +
+                   scalar + "\n    " + scanBackendName(backend) + ": " + other;
+        }
+    }
+    return "";
+}
+
+static std::unique_ptr<Expr> parseSource(const std::string& source, std::string& error) {
+    try {
+        ParseLimits limits;
+        limits.maxDepth = 256;  // raw inputs can nest deeper than the stack allows
+        Lexer lexer(source, ScanBackend::Scalar);
+        Parser parser(lexer.tokenize(), limits);
+        return parser.parse();
+    } catch (const std::runtime_error& ex) {
+        error = ex.what();
+        return nullptr;
+    }
+}
+
+static bool readsWhatItWrites(const Expr& expr) {
+    std::vector<std::string> reads, writes;
+    expr.collectVariables(reads, writes);
+    for (const std::string& name : writes) {
+        if (std::find(reads.begin(), reads.end(), name) != reads.end()) return true;
+    }
+    return false;
+}
+
+static double extraRowValue(std::mt19937_64& rng) {
+    switch (rng() % 4) {
+        case 0: {
+            uint64_t bits = rng();
+            double v;
+            std::memcpy(&v, &bits, sizeof(double));
+            return v;
+        }
+        case 1:  return std::uniform_real_distribution<double>(-1000.0, 1000.0)(rng);
+        default: return INTERESTING[rng() % INTERESTING_COUNT];
+    }
+}
+
+// Batch and aggregate evaluation against per-row tryEvaluate. Every variable of
+// `context` becomes a column whose first row is its current value.
+static std::string checkBatch(const Expr& expr, const VarContext& context, size_t rows, uint32_t rowSeed) {
+    // Batch evaluation has no context to assign into, so it only matches the tree
+    // walker when the formula never reads a variable it assigns
+    if (readsWhatItWrites(expr)) return "";
+
+    std::mt19937_64 rng(rowSeed);
+    std::vector<std::string> names;
+    for (const auto& entry : context) names.push_back(entry.first);
+    std::sort(names.begin(), names.end());
+    std::vector<std::vector<double>> data(names.size(), std::vector<double>(rows));
+    BatchColumns columns;
+    for (size_t v = 0; v < names.size(); ++v) {
+        data[v][0] = context.at(names[v]);
+        for (size_t r = 1; r < rows; ++r) data[v][r] = extraRowValue(rng);
+        columns[names[v]] = data[v].data();
+    }
+    auto rowText = [&](size_t r) {
+        std::string out = "row " + std::to_string(r) + " {";
+        for (size_t v = 0; v < names.size(); ++v) out += (v ? ", " : "") + names[v] + "=" + show(data[v][r]);
+        return out + "}";
+    };
+
+    static ThreadPool pool(3);
+    std::vector<double> out(rows);
+    std::vector<EvalError> errors(rows);
+    std::vector<EvalResult> expected(rows);
+    for (NumericPolicy policy : {NumericPolicy::Strict, NumericPolicy::IEEE}) {
+        const char* policyName = policy == NumericPolicy::Strict ? "strict" : "ieee";
+        for (size_t r = 0; r < rows; ++r) {
+            VarContext row;
+            for (size_t v = 0; v < names.size(); ++v) row[names[v]] = data[v][r];
+            expected[r] = expr.tryEvaluate(row, policy);
+        }
+
+        expr.evaluateBatch(columns, rows, out.data(), errors.data(), policy);
+        for (size_t r = 0; r < rows; ++r) {
+            EvalResult got;
+            got.value = out[r];
+            got.error = errors[r];
+            bool same = got.error == expected[r].error && (!got.ok() || sameValue(got.value, expected[r].value));
+            if (!same) {
+                std::string gotText = got.ok() ? show(got.value) : std::string("error ") + errorName(got.error);
+                return std::string("[batch ") + policyName + "] " + rowText(r) + ": tree walker " +
+                       showResult(expected[r]) + ", batch " + gotText;
+            }
+        }
+
+        // Counts and extremes are exact. With infinite or NaN rows the sum is
+        // exactly what IEEE addition of those rows gives, sign included (finite rows
+        // that do not overflow cannot change it); otherwise it may differ from a
+        // running sum only by rounding. It must not depend on the thread count.
+        size_t refErrors = 0;
+        double refMin = std::numeric_limits<double>::infinity();
+        double refMax = -refMin;
+        long double refSum = 0, refAbs = 0;
+        double nonFinite = 0.0;  // IEEE sum of the infinite and NaN rows
+        bool finite = true;
+        for (const EvalResult& e : expected) {
+            if (!e.ok()) {
+                ++refErrors;
+                continue;
+            }
+            if (std::isfinite(e.value)) {
+                refSum += e.value;
+                refAbs += std::fabs(e.value);
+            } else {
+                nonFinite += e.value;
+                finite = false;
+            }
+            if (!std::isnan(e.value)) {
+                refMin = std::min(refMin, e.value);
+                refMax = std::max(refMax, e.value);
+            }
+        }
+        AggregateResult serial = aggregate(expr, columns, rows, policy);
+        AggregateResult parallel = aggregate(expr, columns, rows, policy, &pool);
+        std::string prefix = std::string("[aggregate ") + policyName + "] ";
+        if (serial.errors != refErrors || serial.count != rows - refErrors) {
+            return prefix + std::to_string(serial.errors) + " errors, tree walker " + std::to_string(refErrors);
+        }
+        // 0 and -0 tie, so which one is the minimum depends on the reduction order
+        if (serial.min != refMin || serial.max != refMax) {
+            return prefix + "min/max " + show(serial.min) + "/" + show(serial.max) + ", tree walker " + show(refMin) +
+                   "/" + show(refMax);
+        }
+        // Near the top of the range, whether a partial sum of finite rows overflows
+        // depends on the order of the additions, so huge finite rows are not compared
+        if (refAbs < 1e300L && !finite) {
+            if (!sameValue(serial.sum, nonFinite)) {
+                return prefix + "sum " + show(serial.sum) + ", tree walker rows add up to " + show(nonFinite);
+            }
+        } else if (refAbs < 1e300L) {
+            long double tolerance = refAbs * 64 * std::numeric_limits<double>::epsilon();
+            if (std::fabs(static_cast<long double>(serial.sum) - refSum) > tolerance) {
+                return prefix + "sum " + show(serial.sum) + ", tree walker " + show(static_cast<double>(refSum));
+            }
+        }
+        if (!sameValue(serial.sum, parallel.sum) || !sameValue(serial.min, parallel.min) ||
+            !sameValue(serial.max, parallel.max) ||
+            serial.errors != parallel.errors) {
+            return prefix + "thread pool result " + show(parallel.sum) + " differs from serial " + show(serial.sum);
+        }
+    }
+    return "";
+}
+
+// Every check on one statement; `node` (may be null) adds the structure and model
+// checks. On success `context` holds the tree walker's variables afterwards.
+static std::string checkStatement(const std::string& source, const GenNode* node, VarContext& context,
+                                  size_t rows, uint32_t rowSeed) {
+    std::string failure = checkLexers(source);
+    if (!failure.empty()) return failure;
+
+    std::string parseError;
+    std::unique_ptr<Expr> expr = parseSource(source, parseError);
+    if (!expr) return node ? "[parse] generated text does not parse: " + parseError : "";
+
+    std::string printed = expr->toString();
+    if (node && printed != canonical(*node)) {
+        return "[parse] parsed as " + printed + ", generated " + canonical(*node);
+    }
+    std::string reparseError;
+    std::unique_ptr<Expr> reparsed = parseSource(printed, reparseError);
+    if (!reparsed) return "[round-trip] toString output " + printed + " does not parse: " + reparseError;
+    if (reparsed->toString() != printed) {
+        return "[round-trip] " + printed + " reprints as " + reparsed->toString();
+    }
+
+    VarContext refContext = context;
+    EvalResult result = expr->tryEvaluate(refContext);
+
+    VarContext roundTripContext = context;
+    EvalResult roundTrip = reparsed->tryEvaluate(roundTripContext);
+    if (!sameResult(result, roundTrip)) {
+        return "[round-trip] " + printed + ": " + showResult(result) + " before, " + showResult(roundTrip) + " after";
+    }
+
+    if (node) {
+        for (NumericPolicy policy : {NumericPolicy::Strict, NumericPolicy::IEEE}) {
+            VarContext walkerContext = context;
+            EvalResult walker = policy == NumericPolicy::Strict ? result : expr->tryEvaluate(walkerContext, policy);
+            if (policy == NumericPolicy::Strict) walkerContext = refContext;
+
+            VarContext modelContext = context;
+            ModelState state;
+            state.policy = policy;
+            EvalResult model;
+            model.value = modelEval(*node, modelContext, state);
+            model.error = state.error;
+            model.variable = &state.variable;
+            const char* policyName = policy == NumericPolicy::Strict ? "strict" : "ieee";
+            if (!sameResult(walker, model)) {
+                return std::string("[model ") + policyName + "] tree walker " + showResult(walker) + ", model " +
+                       showResult(model);
+            }
+            if (!sameContext(walkerContext, modelContext)) {
+                return std::string("[model ") + policyName + "] variables after: tree walker " +
+                       showContext(walkerContext) + ", model " + showContext(modelContext);
+            }
+        }
+    }
+
+    VarContext throwingContext = context;
+    failure = compareThrown("evaluate", result, runThrowing([&] { return expr->evaluate(throwingContext); }));
+    if (failure.empty() && !sameContext(throwingContext, refContext)) failure = "[evaluate] variables differ";
+    if (!failure.empty()) return failure;
+
+    SandboxLimits limits;
+    limits.maxSteps = std::numeric_limits<uint64_t>::max();
+    limits.timeout = std::chrono::nanoseconds(0);
+    Sandbox sandbox(limits);
+    VarContext sandboxContext = context;
+    failure = compareThrown("sandbox", result, runThrowing([&] { return sandbox.evaluate(source, sandboxContext); }));
+    if (failure.empty() && !sameContext(sandboxContext, refContext)) failure = "[sandbox] variables differ";
+    if (!failure.empty()) return failure;
+
+    failure = checkBatch(*expr, context, rows, rowSeed);
+    if (!failure.empty()) return failure;
+
+    context = std::move(refContext);
+    return "";
+}
+
+static VarContext initialContext(const FuzzCase& c) {
+    VarContext context;
+    for (size_t i = 0; i < 4; ++i) context[FUZZ_INPUTS[i]] = c.inputs[i];
+    if (c.initialA) context["a"] = c.valueA;
+    return context;
+}
+
+// The Loader must give every statement the result of running the program line by line
+static std::string checkLoader(const FuzzCase& c, const std::vector<std::string>& sources) {
+    static Loader loader(3);
+    size_t repeat = c.wideProgram ? WIDE_REPEAT : 1;
+    std::string text;
+    std::vector<const std::string*> lines;
+    for (const std::string& source : sources) {
+        for (size_t i = 0; i < repeat; ++i) {
+            text += source + "\n";
+            lines.push_back(&source);
+        }
+    }
+
+    VarContext expectedContext = initialContext(c);
+    VarContext loaderContext = expectedContext;
+    std::vector<StatementResult> results = loader.run(text, loaderContext);
+    if (results.size() != lines.size()) return "[loader] " + std::to_string(results.size()) + " results";
+
+    std::vector<std::unique_ptr<Expr>> asts;
+    for (const std::string& source : sources) {
+        std::string error;
+        asts.push_back(parseSource(source, error));
+    }
+    for (size_t i = 0; i < lines.size(); ++i) {
+        EvalResult expected = asts[i / repeat]->tryEvaluate(expectedContext);
+        const StatementResult& got = results[i];
+        bool same = got.ok == expected.ok() &&
+                    (got.ok ? sameValue(got.value, expected.value) : got.error == expected.message());
+        if (!same) {
+            return "[loader] line " + std::to_string(i + 1) + ": sequential " + showResult(expected) + ", loader " +
+                   (got.ok ? show(got.value) : "error \"" + got.error + "\"");
+        }
+    }
+    if (!sameContext(expectedContext, loaderContext)) {
+        return "[loader] variables after: sequential " + showContext(expectedContext) + ", loader " +
+               showContext(loaderContext);
+    }
+    return "";
+}
+
+std::string checkCase(const FuzzCase& c) {
+    VarContext context = initialContext(c);
+    std::vector<std::string> sources;
+    for (const GenNode& node : c.statements) {
+        sources.push_back(renderStatement(node, c.minimalParens, c.spacing));
+        std::string failure = checkStatement(sources.back(), &node, context, c.rows, c.rowSeed);
+        if (!failure.empty()) return failure;
+    }
+    return checkLoader(c, sources);
+}
+
+std::string checkSource(const std::string& source) {
+    VarContext context;
+    for (size_t i = 0; i < 4; ++i) context[FUZZ_INPUTS[i]] = INTERESTING[(i * 7) % INTERESTING_COUNT];
+    return checkStatement(source, nullptr, context, 1, 0);
+}
+
+// ---------------- Minimization ----------------
+
+static void collectNodes(GenNode& node, std::vector<GenNode*>& out) {
+    out.push_back(&node);
+    for (GenNode& child : node.children) collectNodes(child, out);
+}
+
+static std::vector<GenNode*> allNodes(FuzzCase& c) {
+    std::vector<GenNode*> out;
+    for (GenNode& statement : c.statements) collectNodes(statement, out);
+    return out;
+}
+
+static size_t nodeCount(const FuzzCase& c) {
+    FuzzCase copy = c;
+    return allNodes(copy).size();
+}
+
+// "[check ...] detail" -> "[check ...]"
+static std::string checkName(const std::string& failure) {
+    return failure.substr(0, failure.find(']') + 1);
+}
+
+FuzzCase minimizeCase(const FuzzCase& original, size_t maxAttempts) {
+    FuzzCase best = original;
+    std::string target = checkName(checkCase(original));
+    if (target.empty()) return best;
+    size_t attempts = 0;
+    auto tryCandidate = [&](const FuzzCase& candidate) {
+        if (attempts >= maxAttempts) return false;
+        ++attempts;
+        if (checkName(checkCase(candidate)) != target) return false;
+        best = candidate;
+        return true;
+    };
+
+    bool progress = true;
+    while (progress && attempts < maxAttempts) {
+        progress = false;
+
+        // Fewer statements, fewer rows, plainer layout
+        for (size_t i = 0; i < best.statements.size() && best.statements.size() > 1; ++i) {
+            FuzzCase candidate = best;
+            candidate.statements.erase(candidate.statements.begin() + i);
+            if (tryCandidate(candidate)) progress = true;
+        }
+        for (size_t rows : {size_t(1), size_t(2), best.rows / 2}) {
+            if (rows == 0 || rows >= best.rows) continue;
+            FuzzCase candidate = best;
+            candidate.rows = rows;
+            if (tryCandidate(candidate)) progress = true;
+        }
+        for (int field = 0; field < 3; ++field) {
+            FuzzCase candidate = best;
+            if (field == 0) candidate.wideProgram = false;
+            if (field == 1) candidate.spacing = 0;
+            if (field == 2) candidate.initialA = false;
+            if (field == 0 && !best.wideProgram) continue;
+            if (field == 1 && best.spacing == 0) continue;
+            if (field == 2 && !best.initialA) continue;
+            if (tryCandidate(candidate)) progress = true;
+        }
+
+        // Replace each subtree by one of its children, then by a literal or variable
+        for (size_t i = 0; i < nodeCount(best); ++i) {
+            bool replaced = false;
+            size_t childCount = allNodes(best)[i]->children.size();
+            for (size_t k = 0; k < childCount && !replaced; ++k) {
+                FuzzCase candidate = best;
+                GenNode* node = allNodes(candidate)[i];
+                GenNode child = node->children[k];
+                *node = std::move(child);
+                replaced = tryCandidate(candidate);
+            }
+            for (const char* literal : {"0", "1"}) {
+                if (replaced) break;
+                GenNode* current = allNodes(best)[i];
+                if (current->kind == GenNode::Kind::Number || current->kind == GenNode::Kind::Assignment) continue;
+                FuzzCase candidate = best;
+                *allNodes(candidate)[i] = leaf(GenNode::Kind::Number, literal);
+                replaced = tryCandidate(candidate);
+            }
+            if (!replaced && allNodes(best)[i]->kind == GenNode::Kind::Number && allNodes(best)[i]->text != "0" &&
+                allNodes(best)[i]->text != "1") {
+                FuzzCase candidate = best;
+                *allNodes(candidate)[i] = leaf(GenNode::Kind::Number, "1");
+                replaced = tryCandidate(candidate);
+            }
+            progress |= replaced;
+        }
+
+        // Plainer inputs
+        for (size_t v = 0; v < best.inputs.size(); ++v) {
+            for (double plain : {0.0, 1.0}) {
+                if (sameValue(best.inputs[v], plain)) break;
+                FuzzCase candidate = best;
+                candidate.inputs[v] = plain;
+                if (tryCandidate(candidate)) {
+                    progress = true;
+                    break;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+std::string describeCase(const FuzzCase& c) {
+    std::string out = "  variables: " + showContext(initialContext(c)) + "\n";
+    if (c.rows > 1) {
+        out += "  batch rows: " + std::to_string(c.rows) + " (rows after the first from seed " +
+               std::to_string(c.rowSeed) + ")\n";
+    }
+    if (c.wideProgram) out += "  loader: each statement repeated " + std::to_string(WIDE_REPEAT) + " times\n";
+    for (size_t i = 0; i < c.statements.size(); ++i) {
+        out += "  statement " + std::to_string(i + 1) + ": " +
+               renderStatement(c.statements[i], c.minimalParens, c.spacing) + "\n";
+    }
+    return out;
+}
+
+// ---------------- Entry point ----------------
+
+std::string fuzzOneInput(const uint8_t* data, size_t size) {
+    if (size > 0 && (data[0] & 1)) {
+        std::string source(reinterpret_cast<const char*>(data + 1), std::min<size_t>(size - 1, 4096));
+        if (source.find('\n') != std::string::npos) return "";  // one statement per input
+        std::string failure = checkSource(source);
+        if (failure.empty()) return "";
+        return "mismatch " + failure + "\n  source: \"" + source + "\"\n";
+    }
+
+    ByteSource in(size > 0 ? data + 1 : data, size > 0 ? size - 1 : 0);
+    FuzzCase c = generateCase(in);
+    std::string failure = checkCase(c);
+    if (failure.empty()) return "";
+
+    FuzzCase small = minimizeCase(c);
+    return "mismatch " + failure + "\nreproducer (" + std::to_string(nodeCount(c)) + " nodes minimized to " +
+           std::to_string(nodeCount(small)) + "):\n" + describeCase(small) + "  " + checkCase(small) + "\n";
+}
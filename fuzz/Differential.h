@@ -0,0 +1,77 @@
+#ifndef DIFFERENTIAL_H
+#define DIFFERENTIAL_H
+
+#include "core/AST.h"
+#include "core/Token.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Differential fuzzing of the evaluation backends. Random formulas are run
+// through every lexer backend, the tree walker (tryEvaluate, evaluate, Sandbox),
+// a reference model of the operator semantics, batch and aggregate evaluation
+// and the Loader, and all of them must agree bit for bit (any NaN matches any
+// NaN), errors included.
+
+// Reads fuzzer bytes as a stream of choices. Once the bytes run out every
+// choice is 0, so any byte string decodes to a valid case.
+class ByteSource {
+public:
+    ByteSource(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint8_t byte() { return pos < size ? data[pos++] : 0; }
+    size_t choose(size_t n);  // 0 .. n-1
+    uint32_t word();
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+};
+
+// Generated expression tree. It is kept apart from Expr so it can be rendered
+// with any parenthesization, evaluated by the reference model and shrunk.
+struct GenNode {
+    enum class Kind { Number, Variable, Unary, Binary, Logical, Conditional, Assignment };
+
+    Kind kind = Kind::Number;
+    TokenType op = TokenType::END;  // Unary, Binary, Logical
+    std::string text;               // literal spelling, variable or assigned name
+    std::vector<GenNode> children;
+};
+
+struct FuzzCase {
+    std::vector<GenNode> statements;  // more than one: also run as a program through the Loader
+    std::vector<double> inputs;       // row 0 values of FUZZ_INPUTS
+    bool initialA = false;            // `a` defined before the first statement
+    double valueA = 0.0;
+    size_t rows = 1;                  // batch/aggregate rows; rows after the first come from rowSeed
+    uint32_t rowSeed = 0;
+    bool minimalParens = true;        // otherwise every operation is parenthesized
+    uint32_t spacing = 0;             // seeds the whitespace between tokens
+    bool wideProgram = false;         // Loader check repeats each statement to fill a parallel wave
+};
+
+// Variables with a value in every row; `a` and `b` are assigned, `w` is never defined
+extern const char* const FUZZ_INPUTS[4];
+
+FuzzCase generateCase(ByteSource& in);
+std::string renderStatement(const GenNode& node, bool minimalParens, uint32_t spacing);
+
+// Runs every check; returns "" when all backends agree, else what differed
+std::string checkCase(const FuzzCase& fuzzCase);
+// The same checks on arbitrary text (no reference model, no Loader)
+std::string checkSource(const std::string& source);
+
+// Greedily shrinks a failing case while it keeps failing the same check
+FuzzCase minimizeCase(const FuzzCase& fuzzCase, size_t maxAttempts = 5000);
+// Self-contained reproducer: variables, rows and statements
+std::string describeCase(const FuzzCase& fuzzCase);
+
+// Entry point shared by libFuzzer and the standalone driver. The low bit of the
+// first byte selects raw-text mode (the rest is source text) or a generated case.
+// Returns a report with a minimized reproducer, or "" if nothing differed.
+std::string fuzzOneInput(const uint8_t* data, size_t size);
+
+#endif // DIFFERENTIAL_H
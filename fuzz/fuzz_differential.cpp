@@ -0,0 +1,100 @@
+#include "Differential.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+// libFuzzer entry point: build with -DMINIEXPR_LIBFUZZER -fsanitize=fuzzer
+// (make fuzz-libfuzzer). A mismatch prints its minimized reproducer and aborts,
+// so libFuzzer keeps the input as a crash file.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string report = fuzzOneInput(data, size);
+    if (!report.empty()) {
+        std::fputs(report.c_str(), stderr);
+        std::abort();
+    }
+    return 0;
+}
+
+#ifndef MINIEXPR_LIBFUZZER
+
+// Characters random source text is drawn from in raw-text mode
+static const char ALPHABET[] = "0123456789.eExXabcfwyz_+-*/%&|^~!<>=?:()  \t";
+
+static int usage(const char* argv0) {
+    std::fprintf(stderr, "Usage: %s [--runs N] [--seed S] [input files to replay...]\n", argv0);
+    return 2;
+}
+
+static bool runOne(const std::vector<uint8_t>& input, const std::string& label) {
+    std::string report = fuzzOneInput(input.data(), input.size());
+    if (report.empty()) return true;
+    std::fprintf(stderr, "%s: %s", label.c_str(), report.c_str());
+    return false;
+}
+
+// Standalone driver: replays the given inputs (for example libFuzzer crash
+// files), or runs N random inputs from a seed. The first mismatching input is
+// written to fuzz-failure-<seed>-<run> for replay.
+int main(int argc, char** argv) {
+    unsigned long long runs = 10000;
+    unsigned long long seed = 1;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc) {
+            runs = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!arg.empty() && arg[0] == '-') {
+            return usage(argv[0]);
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    if (!files.empty()) {
+        bool ok = true;
+        for (const std::string& path : files) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file) {
+                std::fprintf(stderr, "Error: cannot read %s\n", path.c_str());
+                return 2;
+            }
+            std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            ok &= runOne(input, path);
+        }
+        std::printf("replayed %zu inputs: %s\n", files.size(), ok ? "no mismatches" : "MISMATCH");
+        return ok ? 0 : 1;
+    }
+
+    std::mt19937_64 rng(seed);
+    unsigned long long text = 0;
+    for (unsigned long long run = 0; run < runs; ++run) {
+        std::vector<uint8_t> input(1 + rng() % 96);
+        for (uint8_t& b : input) b = static_cast<uint8_t>(rng());
+        // One run in four is raw text; the rest decode to generated cases
+        if (rng() % 4 == 0) {
+            ++text;
+            input[0] |= 1;
+            for (size_t i = 1; i < input.size(); ++i) input[i] = ALPHABET[rng() % (sizeof(ALPHABET) - 1)];
+        } else {
+            input[0] &= ~1;
+        }
+
+        if (!runOne(input, "run " + std::to_string(run))) {
+            std::string path = "fuzz-failure-" + std::to_string(seed) + "-" + std::to_string(run);
+            std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(input.data()), input.size());
+            std::fprintf(stderr, "input written to %s\n", path.c_str());
+            return 1;
+        }
+    }
+    std::printf("fuzz: %llu inputs (%llu generated cases, %llu raw text), seed %llu: no mismatches\n", runs,
+                runs - text, text, seed);
+    return 0;
+}
+
+#endif // MINIEXPR_LIBFUZZER
@@ -2,41 +2,150 @@
 #define AST_H
 
 #include "core/Token.h"
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <sstream>
-#include <iomanip>
 #include <unordered_map>
+#include <vector>
 
 // Forward declaration for variable context
 using VarContext = std::unordered_map<std::string, double>;
 
+class EvalBudget;  // see core/Sandbox.h
+
+// Error codes for the non-throwing evaluation path
+enum class EvalError : unsigned char {
+    None,
+    DivisionByZero,
+    ModuloByZero,
+    UndefinedVariable,
+    UnknownOperator
+};
+
+// How division and modulo by zero are treated
+enum class NumericPolicy {
+    Strict,  // report DivisionByZero / ModuloByZero
+    IEEE     // return what IEEE 754 arithmetic gives (+-inf, NaN) and carry on
+};
+
+// Outcome of Expr::tryEvaluate
+struct EvalResult {
+    double value = 0.0;
+    EvalError error = EvalError::None;
+    const std::string* variable = nullptr;  // UndefinedVariable: the name (owned by the AST)
+
+    bool ok() const { return error == EvalError::None; }
+    std::string message() const;  // same text the throwing API uses
+};
+
+// State threaded through one evaluation. The first error sticks; nodes keep
+// evaluating (on NaN) so no branch is needed to unwind, and assignments are
+// skipped once an error is recorded.
+struct EvalState {
+    NumericPolicy policy = NumericPolicy::Strict;
+    EvalError error = EvalError::None;
+    const std::string* variable = nullptr;
+    EvalBudget* budget = nullptr;  // optional sandbox limits (may throw SandboxError)
+
+    void fail(EvalError e, const std::string* name = nullptr) {
+        if (error == EvalError::None) {
+            error = e;
+            variable = name;
+        }
+    }
+};
+
+// Column-oriented input for batch evaluation: each variable maps to an array
+// holding one value per row
+using BatchColumns = std::unordered_map<std::string, const double*>;
+
+// Rows evaluated per evaluateChunk call
+constexpr size_t BATCH_CHUNK = 256;
+
+// Chunk-sized temporaries for the nodes of one batch evaluation. They live on the
+// heap so that deep trees do not exhaust the thread stack. A node holds its slots
+// only while it runs, so the slots in use follow the path from the root and the
+// arena grows to the tree's height once, then is reused for every chunk.
+class BatchScratch {
+public:
+    struct Slot {
+        double values[BATCH_CHUNK];
+        EvalError errors[BATCH_CHUNK];
+    };
+
+    Slot& acquire() {
+        if (used == slots.size()) slots.push_back(std::make_unique<Slot>());
+        return *slots[used++];
+    }
+    void release() { --used; }
+
+private:
+    std::vector<std::unique_ptr<Slot>> slots;  // stable addresses while the vector grows
+    size_t used = 0;
+};
+
+// One chunk of a batch evaluation: rows [offset, offset + count), count <= BATCH_CHUNK
+struct BatchChunk {
+    const BatchColumns* columns;
+    size_t offset;
+    size_t count;
+    NumericPolicy policy;
+    BatchScratch* scratch;
+};
+
 // Base class for all expression nodes
 class Expr {
 public:
     virtual ~Expr() = default;
-    virtual double evaluate(VarContext& context) const = 0;
+
+    // Throwing API: std::runtime_error on evaluation errors
+    double evaluate(VarContext& context) const;
+    // Same result, charging one budget step per node visited until the first error (throws SandboxError)
+    double evaluate(VarContext& context, EvalBudget& budget) const;
+
+    // Non-throwing API: errors come back in the result
+    EvalResult tryEvaluate(VarContext& context, NumericPolicy policy = NumericPolicy::Strict) const;
+
+    // Batch API: evaluates `rows` rows of `columns` into out[] and errors[]. Each row gets
+    // the value and error tryEvaluate would give (out[] is unspecified where errors[] is set).
+    // Conditionals are evaluated with masks instead of branches, and since there is no
+    // variable context, assignments yield their value without storing it.
+    void evaluateBatch(const BatchColumns& columns, size_t rows, double* out, EvalError* errors,
+                       NumericPolicy policy = NumericPolicy::Strict) const;
+
+    // Evaluation core used by the wrappers above; records errors in state, never throws itself
+    virtual double evaluateNode(VarContext& context, EvalState& state) const = 0;
+    // Batch core: fills out[0, chunk.count) and errors[0, chunk.count)
+    virtual void evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const = 0;
     virtual std::string toString() const = 0;
+
+    // Appends the variables this expression reads and assigns (duplicates allowed)
+    virtual void collectVariables(std::vector<std::string>& reads, std::vector<std::string>& writes) const = 0;
 };
 
 // Node for numeric literals
 class NumberNode : public Expr {
 public:
     explicit NumberNode(double value);
-    double evaluate(VarContext& context) const override;
+    double evaluateNode(VarContext& context, EvalState& state) const override;
+    void evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const override;
     std::string toString() const override;
+    void collectVariables(std::vector<std::string>& reads, std::vector<std::string>& writes) const override;
 
 private:
     double value;
 };
 
-// Node for binary operations (+, -, *, /)
+// Node for binary operations (+, -, *, /, comparisons)
 class BinaryOpNode : public Expr {
 public:
     BinaryOpNode(TokenType op, std::unique_ptr<Expr> left, std::unique_ptr<Expr> right);
 
-    double evaluate(VarContext& context) const override;
+    double evaluateNode(VarContext& context, EvalState& state) const override;
+    void evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const override;
     std::string toString() const override;
+    void collectVariables(std::vector<std::string>& reads, std::vector<std::string>& writes) const override;
 
 private:
     TokenType op;
@@ -44,24 +153,60 @@ private:
     std::unique_ptr<Expr> right;
 };
 
-// Node for unary operations (+, -)
+// Node for unary operations (+, -, ~, !)
 class UnaryOpNode : public Expr {
 public:
     UnaryOpNode(TokenType op, std::unique_ptr<Expr> operand);
-    double evaluate(VarContext& context) const override;
+    double evaluateNode(VarContext& context, EvalState& state) const override;
+    void evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const override;
     std::string toString() const override;
+    void collectVariables(std::vector<std::string>& reads, std::vector<std::string>& writes) const override;
 
 private:
     TokenType op;
     std::unique_ptr<Expr> operand;
 };
 
+// Node for && and || (short-circuit; result is 1 or 0)
+class LogicalOpNode : public Expr {
+public:
+    LogicalOpNode(TokenType op, std::unique_ptr<Expr> left, std::unique_ptr<Expr> right);
+
+    double evaluateNode(VarContext& context, EvalState& state) const override;
+    void evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const override;
+    std::string toString() const override;
+    void collectVariables(std::vector<std::string>& reads, std::vector<std::string>& writes) const override;
+
+private:
+    TokenType op;
+    std::unique_ptr<Expr> left;
+    std::unique_ptr<Expr> right;
+};
+
+// Node for cond ? a : b (only the selected branch is evaluated in scalar mode)
+class ConditionalNode : public Expr {
+public:
+    ConditionalNode(std::unique_ptr<Expr> cond, std::unique_ptr<Expr> thenExpr, std::unique_ptr<Expr> elseExpr);
+
+    double evaluateNode(VarContext& context, EvalState& state) const override;
+    void evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const override;
+    std::string toString() const override;
+    void collectVariables(std::vector<std::string>& reads, std::vector<std::string>& writes) const override;
+
+private:
+    std::unique_ptr<Expr> cond;
+    std::unique_ptr<Expr> thenExpr;
+    std::unique_ptr<Expr> elseExpr;
+};
+
 // Node for variables (e.g., a, x, total)
 class VariableNode : public Expr {
 public:
     explicit VariableNode(const std::string& name);
-    double evaluate(VarContext& context) const override;
+    double evaluateNode(VarContext& context, EvalState& state) const override;
+    void evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const override;
     std::string toString() const override;
+    void collectVariables(std::vector<std::string>& reads, std::vector<std::string>& writes) const override;
 
 private:
     std::string name;
@@ -71,8 +216,10 @@ private:
 class AssignmentNode : public Expr {
 public:
     AssignmentNode(std::string varName, std::unique_ptr<Expr> expr);
-    double evaluate(VarContext& context) const override;
+    double evaluateNode(VarContext& context, EvalState& state) const override;
+    void evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const override;
     std::string toString() const override;
+    void collectVariables(std::vector<std::string>& reads, std::vector<std::string>& writes) const override;
 
 private:
     std::string varName;
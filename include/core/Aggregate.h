@@ -0,0 +1,34 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include "core/AST.h"
+#include "core/ThreadPool.h"
+#include <cstddef>
+
+// Rows per aggregation block. Blocks are reduced independently and their partial
+// results combined in block order, so the result does not depend on how many
+// threads took part.
+constexpr size_t AGGREGATE_BLOCK = 16 * BATCH_CHUNK;
+
+// Reduction of one formula over the rows of a batch. Rows that fail to evaluate
+// are only counted in `errors`; all other fields cover the remaining rows.
+struct AggregateResult {
+    double sum = 0.0;     // compensated: pairwise within a chunk, Neumaier across chunks;
+                          // +-inf or NaN as a plain sum would give once a term or the sum is not finite
+    double min;           // +inf when no row succeeded; NaN values are ignored
+    double max;           // -inf when no row succeeded; NaN values are ignored
+    size_t count = 0;     // rows without an error
+    size_t errors = 0;    // rows with an error
+
+    AggregateResult();
+    double mean() const;  // sum / count, NaN when count is 0
+};
+
+// Evaluates `expr` over `rows` rows of `columns` and reduces the results on the fly:
+// only chunk-sized scratch buffers are touched, no per-row output is stored.
+// Row values and errors are those Expr::evaluateBatch gives. With a pool, blocks
+// are spread over its threads; the result is bit-identical either way.
+AggregateResult aggregate(const Expr& expr, const BatchColumns& columns, size_t rows,
+                          NumericPolicy policy = NumericPolicy::Strict, ThreadPool* pool = nullptr);
+
+#endif // AGGREGATE_H
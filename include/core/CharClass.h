@@ -0,0 +1,41 @@
+#ifndef CHAR_CLASS_H
+#define CHAR_CLASS_H
+
+#include <array>
+#include <cstdint>
+
+// Character classes used by the lexer. Unlike <cctype> these are
+// locale-independent, defined for every byte value and inlinable.
+enum CharClass : uint8_t {
+    CC_SPACE = 1 << 0,   // ' ' \t \n \v \f \r
+    CC_DIGIT = 1 << 1,   // 0-9
+    CC_ALPHA = 1 << 2,   // A-Z a-z
+    CC_IDENT = 1 << 3,   // A-Z a-z 0-9 _
+    CC_HEX   = 1 << 4,   // 0-9 A-F a-f
+};
+
+inline constexpr std::array<uint8_t, 256> CHAR_CLASS_TABLE = [] {
+    std::array<uint8_t, 256> table{};
+    for (int c = 0; c < 256; ++c) {
+        uint8_t cls = 0;
+        if (c == ' ' || (c >= '\t' && c <= '\r')) cls |= CC_SPACE;
+        if (c >= '0' && c <= '9') cls |= CC_DIGIT | CC_IDENT | CC_HEX;
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) cls |= CC_ALPHA | CC_IDENT;
+        if ((c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f')) cls |= CC_HEX;
+        if (c == '_') cls |= CC_IDENT;
+        table[c] = cls;
+    }
+    return table;
+}();
+
+inline bool hasCharClass(char ch, uint8_t cls) {
+    return (CHAR_CLASS_TABLE[static_cast<unsigned char>(ch)] & cls) != 0;
+}
+
+inline bool isSpaceChar(char ch) { return hasCharClass(ch, CC_SPACE); }
+inline bool isDigitChar(char ch) { return hasCharClass(ch, CC_DIGIT); }
+inline bool isAlphaChar(char ch) { return hasCharClass(ch, CC_ALPHA); }
+inline bool isIdentChar(char ch) { return hasCharClass(ch, CC_IDENT); }
+inline bool isHexChar(char ch)   { return hasCharClass(ch, CC_HEX); }
+
+#endif // CHAR_CLASS_H
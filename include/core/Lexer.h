@@ -2,19 +2,24 @@
 #define LEXER_H
 
 #include "core/Token.h"
+#include "core/Scan.h"
 #include <string>
 #include <vector>
 
 class Lexer {
 public:
-    explicit Lexer(const std::string& input);
+    // backend selects the whitespace/digit/identifier run scanner; every
+    // backend produces the same token stream
+    explicit Lexer(const std::string& input, ScanBackend backend = ScanBackend::Auto);
     std::vector<Token> tokenize();
 
 private:
     std::string input;
     size_t pos;
+    const Scanner* scanner;
 
     char currentChar();
+    char peekChar(size_t offset);
     void advance();
     void skipWhitespace();
 
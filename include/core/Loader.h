@@ -0,0 +1,46 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "core/AST.h"
+#include "core/ThreadPool.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// One non-blank line of a formula file, lexed and parsed
+struct Statement {
+    size_t line = 0;                 // 1-based line number in the source text
+    std::string source;
+    std::unique_ptr<Expr> ast;       // null if lexing/parsing failed
+    std::string error;               // lexer/parser message when ast is null
+    std::vector<std::string> reads;  // variables read (deduplicated)
+    std::vector<std::string> writes; // variables assigned (deduplicated)
+};
+
+struct StatementResult {
+    bool ok = false;
+    double value = 0.0;
+    std::string error;
+};
+
+// Loads multi-statement input: statements are lexed and parsed concurrently, then
+// evaluated with the same results as running them one by one in source order.
+// Statements whose read/write sets do not conflict are evaluated in parallel.
+class Loader {
+public:
+    // threads = total threads including the caller; 0 means hardware concurrency
+    explicit Loader(unsigned threads = 0);
+
+    std::vector<Statement> parse(const std::string& text);
+    std::vector<StatementResult> evaluate(const std::vector<Statement>& statements, VarContext& context);
+
+    // parse + evaluate
+    std::vector<StatementResult> run(const std::string& text, VarContext& context);
+
+    unsigned threadCount() const { return pool.size(); }
+
+private:
+    ThreadPool pool;
+};
+
+#endif // LOADER_H
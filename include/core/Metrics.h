@@ -0,0 +1,155 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "core/AST.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Pipeline stages with latency histograms
+enum class Stage { Lex, Parse, Evaluate, Count };
+
+// Event counters
+enum class Counter {
+    TokensLexed,
+    NodesParsed,
+    Evaluations,        // Expr::evaluate / tryEvaluate calls (including via Sandbox, Loader, Server)
+    BatchRows,          // rows evaluated by evaluateBatch / aggregate
+    LexErrors,
+    ParseErrors,        // including parser sandbox limits
+    DivisionByZero,
+    ModuloByZero,
+    UndefinedVariable,
+    UnknownOperator,
+    EvalLimitErrors,    // evaluations aborted by sandbox step/time limits
+    Count
+};
+
+// Latency distribution in power-of-two nanosecond buckets: bucket i holds
+// samples in [2^i, 2^(i+1)) ns (bucket 0 also holds 0 and 1 ns)
+struct LatencyHistogram {
+    static constexpr size_t BUCKETS = 40;
+    uint64_t buckets[BUCKETS] = {};
+    uint64_t count = 0;
+    uint64_t sumNanos = 0;
+
+    // Upper bound of the bucket holding quantile q (0..1), 0 when empty
+    uint64_t quantileNanos(double q) const;
+};
+
+// Merged view of every thread's metrics at one point in time
+struct MetricsSnapshot {
+    uint64_t counters[static_cast<size_t>(Counter::Count)] = {};
+    LatencyHistogram stages[static_cast<size_t>(Stage::Count)];
+
+    uint64_t value(Counter c) const { return counters[static_cast<size_t>(c)]; }
+    const LatencyHistogram& latency(Stage s) const { return stages[static_cast<size_t>(s)]; }
+};
+
+// Process-wide metrics. Each thread updates its own counters (no shared cache
+// lines, no atomic read-modify-write); snapshot() merges them. Latency is timed
+// on one call in every sampleInterval per stage and thread, so histogram counts
+// are sample counts. An untimed stage call costs one relaxed load of the flag
+// word and a countdown decrement; evaluations are derived from the countdown.
+class Metrics {
+public:
+    static void setEnabled(bool on) {
+        if (on) flagWord.fetch_or(ENABLED, std::memory_order_relaxed);
+        else flagWord.fetch_and(~ENABLED, std::memory_order_relaxed);
+    }
+    static bool enabled() { return (flags() & ENABLED) != 0; }
+
+    // 1 times every call; the default is 256
+    static void setSampleInterval(uint32_t interval);
+
+    static void add(Counter c, uint64_t n = 1) {
+        if (enabled()) addSlow(c, n);
+    }
+
+    static MetricsSnapshot snapshot();
+    static void reset();  // later snapshots count from here; updates racing with it may or may not be included
+
+    // Exposition formats
+    static std::string toPrometheus(const MetricsSnapshot& snapshot);
+    static std::string toJson(const MetricsSnapshot& snapshot);
+
+    // Chrome trace-event output: while tracing, every stage call is timed and
+    // recorded (up to MAX_TRACE_EVENTS, later events are dropped and counted)
+    static constexpr size_t MAX_TRACE_EVENTS = 1 << 20;
+    static void startTrace();
+    static void stopTrace();
+    static bool tracing() { return (flags() & TRACING) != 0; }
+    static std::string traceJson();  // {"traceEvents": [...]}, loadable in chrome://tracing or Perfetto
+    static bool writeTrace(const std::string& path);
+
+private:
+    friend class StageScope;
+    static constexpr uint32_t ENABLED = 1;
+    static constexpr uint32_t TRACING = 2;
+    static std::atomic<uint32_t> flagWord;
+
+    static uint32_t flags() { return flagWord.load(std::memory_order_relaxed); }
+
+    static void addSlow(Counter c, uint64_t n);
+};
+
+// Per-thread state used on every StageScope, defined here so the common path
+// (enabled, not sampled, no error) is inline and needs no call. Only the owning
+// thread writes it; snapshot() reads it, hence relaxed atomics without
+// read-modify-write.
+struct ThreadHotMetrics {
+    // Calls left until the next sample, and the value the countdown last started
+    // from: period - countdown calls have not been added to the counters yet.
+    // Starting at 1 makes the first call take the slow path, which registers the thread.
+    std::atomic<uint32_t> countdown[static_cast<size_t>(Stage::Count)] = {1, 1, 1};
+    std::atomic<uint32_t> period[static_cast<size_t>(Stage::Count)] = {1, 1, 1};
+};
+inline thread_local ThreadHotMetrics threadHotMetrics;
+
+// Times one stage call (sampled). A scope left without succeed() - normally by
+// an exception - counts as an error of its stage. Evaluate scopes also count the
+// evaluation and the EvalError passed to succeed().
+class StageScope {
+public:
+    explicit StageScope(Stage stage) : stage(stage) {
+        uint32_t flags = Metrics::flags();
+        if (flags == 0) return;
+        active = true;
+        if (flags & Metrics::ENABLED) {
+            std::atomic<uint32_t>& countdown = threadHotMetrics.countdown[static_cast<size_t>(stage)];
+            uint32_t left = countdown.load(std::memory_order_relaxed) - 1;
+            countdown.store(left, std::memory_order_relaxed);
+            if (left == 0 || (flags & Metrics::TRACING)) begin(flags);
+        } else {
+            begin(flags);  // tracing only
+        }
+    }
+    ~StageScope() {
+        if (active && (timed || !succeeded || error != EvalError::None)) end();
+    }
+
+    StageScope(const StageScope&) = delete;
+    StageScope& operator=(const StageScope&) = delete;
+
+    void succeed(EvalError evalError = EvalError::None) {
+        succeeded = true;
+        error = evalError;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Stage stage;
+    bool active = false;
+    bool timed = false;
+    bool succeeded = false;
+    EvalError error = EvalError::None;
+    Clock::time_point start;
+
+    void begin(uint32_t flags);
+    void end();
+};
+
+#endif // METRICS_H
@@ -0,0 +1,22 @@
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include <cstddef>
+#include <string>
+
+// Large enough for the longest shortest-round-trip double ("-2.2250738585072014e-308")
+constexpr std::size_t NUMBER_BUFFER_SIZE = 32;
+
+// Writes the shortest text that parses back to exactly `value` into [first, last).
+// Integral values below 1e15 are written without exponent (1000000, not 1e+06).
+// Returns one past the last character written; the buffer is not NUL-terminated.
+char* formatNumber(double value, char* first, char* last);
+
+// Convenience wrapper around the buffer version
+std::string formatNumber(double value);
+
+// Parses a decimal or scientific literal ("2.5", "1e-9") covering all of [first, last).
+// Returns false if the text is malformed or has trailing characters.
+bool parseNumber(const char* first, const char* last, double& out);
+
+#endif // NUMBER_FORMAT_H
@@ -0,0 +1,27 @@
+#ifndef NUMERIC_H
+#define NUMERIC_H
+
+#include <limits>
+
+// Integer semantics of the bitwise operators, shared by the scalar and batch evaluators.
+
+// Operand conversion for the bitwise operators. NaN and values outside int range
+// map to INT_MIN (what x86's truncating conversion yields) instead of being UB.
+// Written as selects rather than an early return so batch loops stay branch-free.
+inline int toInt(double v) {
+    bool inRange = v > -2147483649.0 && v < 2147483648.0;
+    int truncated = static_cast<int>(inRange ? v : 0.0);
+    return inRange ? truncated : std::numeric_limits<int>::min();
+}
+
+// Shift counts use the low 5 bits, as the x86 shift instructions do;
+// left shifts go through unsigned so shifting into the sign bit is defined
+inline int shiftLeft(int value, int count) {
+    return static_cast<int>(static_cast<unsigned>(value) << (count & 31));
+}
+
+inline int shiftRight(int value, int count) {
+    return value >> (count & 31);
+}
+
+#endif // NUMERIC_H
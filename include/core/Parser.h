@@ -5,20 +5,42 @@
 #include "core/AST.h"
 #include <vector>
 #include <memory>
+#include <cstddef>
+#include <limits>
+
+// Limits for untrusted input; exceeding one throws SandboxError
+struct ParseLimits {
+    size_t maxDepth = std::numeric_limits<size_t>::max();  // AST height, and nesting of parentheses
+    size_t maxNodes = std::numeric_limits<size_t>::max();  // AST nodes created
+};
 
 class Parser {
 public:
-    explicit Parser(const std::vector<Token>& tokens);
+    explicit Parser(const std::vector<Token>& tokens, const ParseLimits& limits = ParseLimits());
+    explicit Parser(std::vector<Token>&& tokens, const ParseLimits& limits = ParseLimits());
     std::unique_ptr<Expr> parse();
 
 private:
     std::vector<Token> tokens;
     size_t pos;
+    ParseLimits limits;
+    size_t depth = 0;
+    size_t nodeCount = 0;
+    size_t height = 0;  // height of the subtree the last rule returned
+
+    struct DepthGuard;
+    template <typename Node, typename... Args>
+    std::unique_ptr<Expr> makeNode(size_t childHeight, Args&&... args);
 
     const Token& currentToken() const;
     void advance();
 
     std::unique_ptr<Expr> assignment();   // parse assignment expressions
+    std::unique_ptr<Expr> conditional();  // conditional → logical_or ('?' conditional ':' conditional)?
+    std::unique_ptr<Expr> logical_or();
+    std::unique_ptr<Expr> logical_and();
+    std::unique_ptr<Expr> equality();
+    std::unique_ptr<Expr> comparison();
     std::unique_ptr<Expr> expr();         // expr → term ((+|-) term)*
     std::unique_ptr<Expr> term();         // term → factor ((*|/) factor)*
     std::unique_ptr<Expr> power();        // new
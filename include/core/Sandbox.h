@@ -0,0 +1,80 @@
+#ifndef SANDBOX_H
+#define SANDBOX_H
+
+#include "core/AST.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// Resource limits for evaluating untrusted formulas
+struct SandboxLimits {
+    size_t maxInputLength = 64 * 1024;  // characters of source text
+    size_t maxNodes = 10000;            // AST nodes built by the parser
+    size_t maxDepth = 256;              // AST height (bounds evaluation recursion) and parenthesis nesting
+    uint64_t maxSteps = 1000000;        // AST nodes visited during evaluation
+    std::chrono::nanoseconds timeout = std::chrono::milliseconds(10);  // wall clock per formula, 0 = none
+};
+
+// Thrown when a formula exceeds one of the SandboxLimits. Distinct from the
+// std::runtime_error thrown for ordinary lexer/parser/evaluation errors.
+class SandboxError : public std::runtime_error {
+public:
+    enum class Kind { InputTooLong, NodeLimit, DepthLimit, StepLimit, Timeout };
+
+    SandboxError(Kind kind, const std::string& message);
+    Kind kind() const { return errorKind; }
+
+private:
+    Kind errorKind;
+};
+
+// Step counter threaded through Expr::evaluate. The clock is only read every
+// CLOCK_CHECK_INTERVAL steps, so the per-node cost is an increment and a compare.
+class EvalBudget {
+public:
+    static constexpr uint64_t CLOCK_CHECK_INTERVAL = 1024;
+    using Clock = std::chrono::steady_clock;
+
+    // deadline == Clock::time_point::max() disables the wall-clock limit
+    EvalBudget(uint64_t maxSteps, Clock::time_point deadline);
+
+    void step() {
+        if (++steps >= nextCheck) checkLimits();
+    }
+
+    uint64_t stepsTaken() const { return steps; }
+
+private:
+    uint64_t steps = 0;
+    uint64_t nextCheck;
+    uint64_t maxSteps;
+    Clock::time_point deadline;
+
+    void checkLimits();
+};
+
+// Compiles and evaluates formulas under SandboxLimits
+class Sandbox {
+public:
+    explicit Sandbox(const SandboxLimits& limits = SandboxLimits());
+
+    // Lex + parse with input length, node count and depth limits
+    std::unique_ptr<Expr> compile(const std::string& source) const;
+
+    // Evaluate with step and wall-clock limits
+    double evaluate(const Expr& expr, VarContext& context) const;
+
+    // compile + evaluate; the timeout covers both
+    double evaluate(const std::string& source, VarContext& context) const;
+
+    const SandboxLimits& limits() const { return sandboxLimits; }
+
+private:
+    SandboxLimits sandboxLimits;
+
+    EvalBudget makeBudget(EvalBudget::Clock::time_point start) const;
+};
+
+#endif // SANDBOX_H
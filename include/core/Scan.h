@@ -0,0 +1,30 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstddef>
+
+// Run scanners used by the lexer. Each returns the first index >= pos whose
+// character is NOT in the scanned class (or len if the run reaches the end).
+enum class ScanBackend {
+    Auto,    // best backend supported by the running CPU
+    Scalar,  // table lookups, one byte at a time
+    SSE42,   // PCMPESTRI range matching, 16 bytes at a time
+    AVX2     // compare/movemask, 32 bytes at a time
+};
+
+struct Scanner {
+    size_t (*skipSpaces)(const char* data, size_t pos, size_t len);
+    size_t (*skipDigits)(const char* data, size_t pos, size_t len);
+    size_t (*skipIdentifier)(const char* data, size_t pos, size_t len);
+};
+
+// Returns the scanner for `backend`; Auto resolves to the fastest supported one.
+// Throws std::runtime_error if an explicit backend is not supported here.
+const Scanner& getScanner(ScanBackend backend);
+
+bool isScanBackendSupported(ScanBackend backend);
+
+// Name for benchmark/test output ("scalar", "sse4.2", "avx2")
+const char* scanBackendName(ScanBackend backend);
+
+#endif // SCAN_H
@@ -0,0 +1,136 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "core/AST.h"
+#include "core/Sandbox.h"
+#include "core/ThreadPool.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Wire protocol (all integers little-endian):
+//   request:  u32 length | u8 opcode | body[length - 1]
+//   response: u32 length | u8 status | body[length - 1]
+// EVAL carries formula text. RESET clears the connection's variables (empty body).
+// A successful reply carries an 8-byte IEEE double (0 for RESET), a failed one
+// the error message. Replies come back in request order, so clients may
+// pipeline any number of requests.
+enum class ServerOp : uint8_t { Eval = 1, Reset = 2 };
+enum class ServerStatus : uint8_t { Ok = 0, Error = 1 };
+
+constexpr size_t FRAME_HEADER_SIZE = 4;
+
+struct ServerOptions {
+    std::string socketPath;
+    unsigned threads = 1;               // evaluation threads including the event loop; 0 = hardware
+    size_t maxFrameSize = 64 * 1024;    // larger requests close the connection
+    size_t cacheCapacity = 4096;        // compiled formulas kept across requests
+    SandboxLimits limits;               // applied to every formula
+};
+
+struct ServerReply {
+    ServerStatus status = ServerStatus::Error;
+    double value = 0.0;
+    std::string error;
+
+    bool ok() const { return status == ServerStatus::Ok; }
+};
+
+// Frame encoding shared by the server and ServerClient
+void appendRequest(std::string& out, ServerOp op, const std::string& body);
+void appendReply(std::string& out, const ServerReply& reply);
+
+// Long-running evaluation server on a Unix domain socket (Linux, epoll).
+// Each connection has its own VarContext. Every wakeup of the event loop reads
+// all pending frames from all ready connections and evaluates them as one batch:
+// formulas are compiled once through a shared cache, connections are evaluated
+// in parallel (each in request order), and each connection's replies go out in
+// a single write.
+class Server {
+public:
+    explicit Server(const ServerOptions& options);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Binds the socket (replacing a stale socket file); throws std::runtime_error on failure
+    void listen();
+
+    // Runs the event loop until stop() is called; calls listen() first if needed
+    void run();
+
+    // Safe to call from any thread or a signal handler
+    void stop();
+
+    size_t cachedFormulas() const { return cache.size(); }
+
+private:
+    struct Compiled {
+        std::unique_ptr<Expr> ast;  // null when compilation failed
+        std::string error;
+    };
+
+    struct Request {
+        ServerOp op;  // may hold an unknown opcode, answered with an error
+        std::shared_ptr<const Compiled> formula;  // Eval only
+    };
+
+    struct Connection {
+        int fd = -1;
+        VarContext session;
+        std::string input;             // bytes received but not yet decoded
+        std::string output;            // bytes not yet written
+        std::vector<Request> pending;  // decoded this round
+        uint32_t events = 0;           // epoll interest currently registered
+        bool closing = false;          // close once output is flushed
+    };
+
+    ServerOptions options;
+    Sandbox sandbox;
+    ThreadPool pool;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::atomic<bool> stopping{false};
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    std::unordered_map<std::string, std::shared_ptr<const Compiled>> cache;
+
+    void acceptConnections();
+    bool readInput(Connection& conn);
+    void decodeFrames(Connection& conn);
+    std::shared_ptr<const Compiled> compile(const std::string& source);
+    void evaluatePending(Connection& conn) const;
+    void flushOutput(Connection& conn);
+    void updateInterest(Connection& conn);
+    void closeConnection(int fd);
+};
+
+// Blocking client, used by tests and the load generator
+class ServerClient {
+public:
+    explicit ServerClient(const std::string& socketPath);
+    ~ServerClient();
+
+    ServerClient(const ServerClient&) = delete;
+    ServerClient& operator=(const ServerClient&) = delete;
+
+    // One request, one reply
+    ServerReply eval(const std::string& formula);
+    ServerReply reset();
+
+    // Pipelining: send() writes without waiting, receive() reads the next reply in order
+    void send(ServerOp op, const std::string& body);
+    void send(const std::string& encoded);  // one or more frames built with appendRequest
+    ServerReply receive();
+
+private:
+    int fd = -1;
+    std::string buffer;
+    size_t consumed = 0;
+};
+
+#endif // SERVER_H
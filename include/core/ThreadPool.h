@@ -0,0 +1,50 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads for data-parallel loops.
+// The calling thread takes part in every loop, so a pool of size 1 has no workers
+// and runs everything inline.
+class ThreadPool {
+public:
+    // threads = total threads including the caller; 0 means hardware concurrency
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Calls body(begin, end) over [0, count) in chunks of at most `grain` items and
+    // returns once every chunk is done. The first exception thrown by body is rethrown.
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    // Current job, guarded by mutex (next is only advanced under the lock as well)
+    const std::function<void(size_t, size_t)>* body = nullptr;
+    size_t count = 0;
+    size_t grain = 1;
+    size_t next = 0;
+    size_t busy = 0;
+    size_t generation = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    void workerLoop();
+    void runChunks(std::unique_lock<std::mutex>& lock);
+};
+
+#endif // THREAD_POOL_H
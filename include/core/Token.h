@@ -23,6 +23,17 @@ enum class TokenType {
     BIT_NOT,    // ~
     LSHIFT,     // <<
     RSHIFT,      // >>
+    LESS,           // <
+    LESS_EQUAL,     // <=
+    GREATER,        // >
+    GREATER_EQUAL,  // >=
+    EQUAL,          // ==
+    NOT_EQUAL,      // !=
+    LOGICAL_AND,    // &&
+    LOGICAL_OR,     // ||
+    LOGICAL_NOT,    // !
+    QUESTION,       // ?
+    COLON,          // :
     END
 };
 
@@ -34,6 +45,7 @@ struct Token {
     Token(TokenType t, int val);
     Token(TokenType t, double val);
     Token(TokenType t, const std::string& val); 
+    Token(TokenType t, std::string&& val);
     std::string toString() const;
 };
 
@@ -11,8 +11,16 @@
 #include <algorithm>
 #include <cctype>  
 #include <cmath>
+#include <fstream>
+#include <iterator>
+#include <csignal>
+#include <charconv>
 #include "core/Lexer.h"
 #include "core/Parser.h"
 #include "core/AST.h"
+#include "core/NumberFormat.h"
+#include "core/Loader.h"
+#include "core/Server.h"
+#include "core/Metrics.h"
 
 #endif // MAIN_H
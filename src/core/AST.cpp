@@ -1,47 +1,34 @@
 #include "core/AST.h"
+#include "core/Metrics.h"
+#include "core/NumberFormat.h"
+#include "core/Numeric.h"
+#include "core/Sandbox.h"
 #include <stdexcept>
-#include <sstream>
-#include <iomanip>
+#include <limits>
 #include <cmath>  // For std::pow and std::fmod
 
-// ---------------- NumberNode ----------------
-
-NumberNode::NumberNode(double value) : value(value) {}
+// ---------------- Operator semantics ----------------
+// Errors are recorded in EvalState rather than thrown; the value returned
+// alongside an error is NaN and is never observed by callers.
 
-double NumberNode::evaluate(VarContext& /*context*/) const {
-    return value;
-}
-
-std::string NumberNode::toString() const {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(6) << value;
-    std::string s = oss.str();
-    s.erase(s.find_last_not_of('0') + 1, std::string::npos);
-    if (!s.empty() && s.back() == '.') s.pop_back();
-    return s;
-}
-
-// ---------------- BinaryOpNode ----------------
-
-BinaryOpNode::BinaryOpNode(TokenType op, std::unique_ptr<Expr> left, std::unique_ptr<Expr> right)
-    : op(op), left(std::move(left)), right(std::move(right)) {}
-
-double BinaryOpNode::evaluate(VarContext& context) const {
-    double lval = left->evaluate(context);
-    double rval = right->evaluate(context);
-
-    // Helper to convert double to int for bitwise operations
-    auto toInt = [](double v) -> int { return static_cast<int>(v); };
+static constexpr double ERROR_VALUE = std::numeric_limits<double>::quiet_NaN();
 
+static double applyBinary(TokenType op, double lval, double rval, EvalState& state) {
     switch (op) {
         case TokenType::PLUS:  return lval + rval;
         case TokenType::MINUS: return lval - rval;
         case TokenType::MUL:   return lval * rval;
         case TokenType::DIV:
-            if (rval == 0) throw std::runtime_error("Division by zero");
+            if (rval == 0 && state.policy == NumericPolicy::Strict) {
+                state.fail(EvalError::DivisionByZero);
+                return ERROR_VALUE;
+            }
             return lval / rval;
         case TokenType::MOD:
-            if (rval == 0) throw std::runtime_error("Modulo by zero");
+            if (rval == 0 && state.policy == NumericPolicy::Strict) {
+                state.fail(EvalError::ModuloByZero);
+                return ERROR_VALUE;
+            }
             return std::fmod(lval, rval);
         case TokenType::POWER:
             return std::pow(lval, rval);
@@ -54,72 +41,215 @@ double BinaryOpNode::evaluate(VarContext& context) const {
         case TokenType::BIT_XOR:
             return toInt(lval) ^ toInt(rval);
         case TokenType::LSHIFT:
-            return toInt(lval) << toInt(rval);
+            return shiftLeft(toInt(lval), toInt(rval));
         case TokenType::RSHIFT:
-            return toInt(lval) >> toInt(rval);
+            return shiftRight(toInt(lval), toInt(rval));
+
+        // Comparisons yield 1 or 0
+        case TokenType::LESS:          return lval < rval;
+        case TokenType::LESS_EQUAL:    return lval <= rval;
+        case TokenType::GREATER:       return lval > rval;
+        case TokenType::GREATER_EQUAL: return lval >= rval;
+        case TokenType::EQUAL:         return lval == rval;
+        case TokenType::NOT_EQUAL:     return lval != rval;
 
         default:
-            throw std::runtime_error("Unknown binary operator");
+            state.fail(EvalError::UnknownOperator);
+            return ERROR_VALUE;
     }
 }
 
-std::string BinaryOpNode::toString() const {
-    std::ostringstream oss;
-    oss << "(" << left->toString() << " "
-        << (op == TokenType::PLUS ? "+" :
-            op == TokenType::MINUS ? "-" :
-            op == TokenType::MUL ? "*" :
-            op == TokenType::DIV ? "/" :
-            op == TokenType::MOD ? "%" :
-            op == TokenType::POWER ? "**" :
-            op == TokenType::BIT_AND ? "&" :
-            op == TokenType::BIT_OR ? "|" :
-            op == TokenType::BIT_XOR ? "^" :
-            op == TokenType::LSHIFT ? "<<" :
-            op == TokenType::RSHIFT ? ">>" : "?")
-        << " " << right->toString() << ")";
-    return oss.str();
-}
-
-// ---------------- UnaryOpNode ----------------
-
-UnaryOpNode::UnaryOpNode(TokenType op, std::unique_ptr<Expr> operand)
-    : op(op), operand(std::move(operand)) {}
-
-double UnaryOpNode::evaluate(VarContext& context) const {
-    double val = operand->evaluate(context);
-
+static double applyUnary(TokenType op, double val, EvalState& state) {
     switch (op) {
         case TokenType::PLUS:
             return val;
         case TokenType::MINUS:
             return -val;
         case TokenType::BIT_NOT:
-            return ~static_cast<int>(val);
+            return ~toInt(val);
+        case TokenType::LOGICAL_NOT:
+            return val == 0;
         default:
-            throw std::runtime_error("Unknown unary operator");
+            state.fail(EvalError::UnknownOperator);
+            return ERROR_VALUE;
     }
 }
 
+// Overwrites through find() first: updating an existing entry never touches the
+// table structure, which lets the Loader evaluate independent statements against one context
+static void storeVariable(const std::string& name, double val, VarContext& context) {
+    auto it = context.find(name);
+    if (it != context.end()) {
+        it->second = val;
+    } else {
+        context.emplace(name, val);
+    }
+}
+
+// Charges one sandbox step when a budget is attached. Nodes evaluated after the
+// first error are free, so a later StepLimit or Timeout cannot mask that error.
+static inline void chargeStep(EvalState& state) {
+    if (state.budget && state.error == EvalError::None) state.budget->step();
+}
+
+// ---------------- EvalResult ----------------
+
+std::string EvalResult::message() const {
+    switch (error) {
+        case EvalError::None:              return "";
+        case EvalError::DivisionByZero:    return "Division by zero";
+        case EvalError::ModuloByZero:      return "Modulo by zero";
+        case EvalError::UndefinedVariable: return "Undefined variable: " + (variable ? *variable : std::string("?"));
+        case EvalError::UnknownOperator:   return "Unknown operator";
+    }
+    return "Unknown error";
+}
+
+// ---------------- Expr ----------------
+
+static EvalResult runEvaluation(const Expr& expr, VarContext& context, EvalState& state) {
+    StageScope scope(Stage::Evaluate);
+    EvalResult result;
+    result.value = expr.evaluateNode(context, state);
+    result.error = state.error;
+    result.variable = state.variable;
+    scope.succeed(result.error);
+    return result;
+}
+
+EvalResult Expr::tryEvaluate(VarContext& context, NumericPolicy policy) const {
+    EvalState state;
+    state.policy = policy;
+    return runEvaluation(*this, context, state);
+}
+
+double Expr::evaluate(VarContext& context) const {
+    EvalState state;
+    EvalResult result = runEvaluation(*this, context, state);
+    if (!result.ok()) throw std::runtime_error(result.message());
+    return result.value;
+}
+
+double Expr::evaluate(VarContext& context, EvalBudget& budget) const {
+    EvalState state;
+    state.budget = &budget;
+    EvalResult result = runEvaluation(*this, context, state);
+    if (!result.ok()) throw std::runtime_error(result.message());
+    return result.value;
+}
+
+// ---------------- NumberNode ----------------
+
+NumberNode::NumberNode(double value) : value(value) {}
+
+double NumberNode::evaluateNode(VarContext& /*context*/, EvalState& state) const {
+    chargeStep(state);
+    return value;
+}
+
+std::string NumberNode::toString() const {
+    return formatNumber(value);
+}
+
+void NumberNode::collectVariables(std::vector<std::string>& /*reads*/, std::vector<std::string>& /*writes*/) const {}
+
+// ---------------- BinaryOpNode ----------------
+
+BinaryOpNode::BinaryOpNode(TokenType op, std::unique_ptr<Expr> left, std::unique_ptr<Expr> right)
+    : op(op), left(std::move(left)), right(std::move(right)) {}
+
+double BinaryOpNode::evaluateNode(VarContext& context, EvalState& state) const {
+    chargeStep(state);
+    double lval = left->evaluateNode(context, state);
+    double rval = right->evaluateNode(context, state);
+    return applyBinary(op, lval, rval, state);
+}
+
+std::string BinaryOpNode::toString() const {
+    return "(" + left->toString() + " " + Token(op).toString() + " " + right->toString() + ")";
+}
+
+void BinaryOpNode::collectVariables(std::vector<std::string>& reads, std::vector<std::string>& writes) const {
+    left->collectVariables(reads, writes);
+    right->collectVariables(reads, writes);
+}
+
+// ---------------- UnaryOpNode ----------------
+
+UnaryOpNode::UnaryOpNode(TokenType op, std::unique_ptr<Expr> operand)
+    : op(op), operand(std::move(operand)) {}
+
+double UnaryOpNode::evaluateNode(VarContext& context, EvalState& state) const {
+    chargeStep(state);
+    return applyUnary(op, operand->evaluateNode(context, state), state);
+}
+
 std::string UnaryOpNode::toString() const {
-    std::string opStr;
-    switch (op) {
-        case TokenType::PLUS: opStr = "+"; break;
-        case TokenType::MINUS: opStr = "-"; break;
-        case TokenType::BIT_NOT: opStr = "~"; break;
-        default: opStr = "?"; break;
+    return "(" + Token(op).toString() + operand->toString() + ")";
+}
+
+void UnaryOpNode::collectVariables(std::vector<std::string>& reads, std::vector<std::string>& writes) const {
+    operand->collectVariables(reads, writes);
+}
+
+// ---------------- LogicalOpNode ----------------
+
+LogicalOpNode::LogicalOpNode(TokenType op, std::unique_ptr<Expr> left, std::unique_ptr<Expr> right)
+    : op(op), left(std::move(left)), right(std::move(right)) {}
+
+double LogicalOpNode::evaluateNode(VarContext& context, EvalState& state) const {
+    chargeStep(state);
+    if (op != TokenType::LOGICAL_AND && op != TokenType::LOGICAL_OR) {
+        state.fail(EvalError::UnknownOperator);
+        return ERROR_VALUE;
     }
-    return "(" + opStr + operand->toString() + ")";
+    bool lhs = left->evaluateNode(context, state) != 0;
+    // Short-circuit: the right operand (and any error it would raise) is skipped
+    if (op == TokenType::LOGICAL_AND ? !lhs : lhs) return lhs;
+    return right->evaluateNode(context, state) != 0;
+}
+
+std::string LogicalOpNode::toString() const {
+    return "(" + left->toString() + " " + Token(op).toString() + " " + right->toString() + ")";
+}
+
+void LogicalOpNode::collectVariables(std::vector<std::string>& reads, std::vector<std::string>& writes) const {
+    left->collectVariables(reads, writes);
+    right->collectVariables(reads, writes);
+}
+
+// ---------------- ConditionalNode ----------------
+
+ConditionalNode::ConditionalNode(std::unique_ptr<Expr> cond, std::unique_ptr<Expr> thenExpr, std::unique_ptr<Expr> elseExpr)
+    : cond(std::move(cond)), thenExpr(std::move(thenExpr)), elseExpr(std::move(elseExpr)) {}
+
+double ConditionalNode::evaluateNode(VarContext& context, EvalState& state) const {
+    chargeStep(state);
+    if (cond->evaluateNode(context, state) != 0) return thenExpr->evaluateNode(context, state);
+    return elseExpr->evaluateNode(context, state);
+}
+
+std::string ConditionalNode::toString() const {
+    return "(" + cond->toString() + " ? " + thenExpr->toString() + " : " + elseExpr->toString() + ")";
+}
+
+// Both branches count: the Loader needs every variable that may be touched
+void ConditionalNode::collectVariables(std::vector<std::string>& reads, std::vector<std::string>& writes) const {
+    cond->collectVariables(reads, writes);
+    thenExpr->collectVariables(reads, writes);
+    elseExpr->collectVariables(reads, writes);
 }
 
 // ---------------- VariableNode ----------------
 
 VariableNode::VariableNode(const std::string& name) : name(name) {}
 
-double VariableNode::evaluate(VarContext& context) const {
+double VariableNode::evaluateNode(VarContext& context, EvalState& state) const {
+    chargeStep(state);
     auto it = context.find(name);
     if (it == context.end()) {
-        throw std::runtime_error("Undefined variable: " + name);
+        state.fail(EvalError::UndefinedVariable, &name);
+        return ERROR_VALUE;
     }
     return it->second;
 }
@@ -128,17 +258,29 @@ std::string VariableNode::toString() const {
     return name;
 }
 
+void VariableNode::collectVariables(std::vector<std::string>& reads, std::vector<std::string>& /*writes*/) const {
+    reads.push_back(name);
+}
+
 // ---------------- AssignmentNode ----------------
 
 AssignmentNode::AssignmentNode(std::string varName, std::unique_ptr<Expr> expr)
     : varName(std::move(varName)), expr(std::move(expr)) {}
 
-double AssignmentNode::evaluate(VarContext& context) const {
-    double val = expr->evaluate(context);
-    context[varName] = val;
+double AssignmentNode::evaluateNode(VarContext& context, EvalState& state) const {
+    chargeStep(state);
+    double val = expr->evaluateNode(context, state);
+    if (state.error == EvalError::None) storeVariable(varName, val, context);  // failed assignments store nothing
     return val;
 }
 
+// No parentheses: assignments only parse at the start of a statement, and the
+// printed form must parse back
 std::string AssignmentNode::toString() const {
-    return "(" + varName + " = " + expr->toString() + ")";
+    return varName + " = " + expr->toString();
+}
+
+void AssignmentNode::collectVariables(std::vector<std::string>& reads, std::vector<std::string>& writes) const {
+    expr->collectVariables(reads, writes);
+    writes.push_back(varName);
 }
@@ -0,0 +1,140 @@
+#include "core/Aggregate.h"
+#include "core/Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Neumaier's compensated sum: the rounding error of every addition is kept in
+// `compensation` and added back at the end. Infinite and NaN terms, and a running
+// sum that overflows, go to `nonFinite` instead: inf - inf in the error term
+// would otherwise turn the whole sum into NaN.
+struct CompensatedSum {
+    double sum = 0.0;
+    double compensation = 0.0;
+    double nonFinite = 0.0;  // 0, or the IEEE sum of the non-finite parts
+
+    void add(double v) {
+        if (!std::isfinite(v)) {
+            nonFinite += v;
+            return;
+        }
+        double t = sum + v;
+        if (!std::isfinite(t)) {
+            nonFinite += t;
+            return;
+        }
+        if (std::fabs(sum) >= std::fabs(v)) {
+            compensation += (sum - t) + v;
+        } else {
+            compensation += (v - t) + sum;
+        }
+        sum = t;
+    }
+
+    void add(const CompensatedSum& other) {
+        nonFinite += other.nonFinite;
+        add(other.sum);
+        add(other.compensation);
+    }
+
+    double value() const { return nonFinite != 0.0 ? nonFinite : sum + compensation; }
+};
+
+struct BlockTotals {
+    CompensatedSum sum;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    size_t errors = 0;
+};
+
+// Reduces one evaluated chunk with fixed pairwise trees over BATCH_CHUNK slots.
+// Failed rows (and NaN values, for min/max) are replaced by each reduction's
+// identity first, so every loop is branch-free and vectorizes, and the result
+// depends only on the chunk's values.
+static void reduceChunk(size_t n, double* values, const EvalError* errors, BlockTotals& totals) {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+    double lo[BATCH_CHUNK];
+    double hi[BATCH_CHUNK];
+    size_t failed = 0;
+    for (size_t i = 0; i < n; ++i) failed += errors[i] != EvalError::None;
+    for (size_t i = 0; i < n; ++i) {
+        bool ok = errors[i] == EvalError::None;
+        bool ranged = ok & (values[i] == values[i]);
+        lo[i] = ranged ? values[i] : INF;
+        hi[i] = ranged ? values[i] : -INF;
+        values[i] = ok ? values[i] : 0.0;
+    }
+    std::fill(values + n, values + BATCH_CHUNK, 0.0);
+    std::fill(lo + n, lo + BATCH_CHUNK, INF);
+    std::fill(hi + n, hi + BATCH_CHUNK, -INF);
+
+    for (size_t half = BATCH_CHUNK / 2; half > 0; half /= 2) {
+        for (size_t i = 0; i < half; ++i) {
+            values[i] += values[i + half];
+            lo[i] = lo[i + half] < lo[i] ? lo[i + half] : lo[i];
+            hi[i] = hi[i + half] > hi[i] ? hi[i + half] : hi[i];
+        }
+    }
+
+    totals.sum.add(values[0]);
+    totals.min = lo[0] < totals.min ? lo[0] : totals.min;
+    totals.max = hi[0] > totals.max ? hi[0] : totals.max;
+    totals.errors += failed;
+}
+
+static BlockTotals reduceBlock(const Expr& expr, const BatchColumns& columns, size_t begin, size_t end,
+                               NumericPolicy policy) {
+    BlockTotals totals;
+    double values[BATCH_CHUNK];
+    EvalError errors[BATCH_CHUNK];
+    BatchScratch scratch;
+    for (size_t offset = begin; offset < end; offset += BATCH_CHUNK) {
+        BatchChunk chunk{&columns, offset, std::min(BATCH_CHUNK, end - offset), policy, &scratch};
+        expr.evaluateChunk(chunk, values, errors);
+        reduceChunk(chunk.count, values, errors, totals);
+    }
+    return totals;
+}
+
+AggregateResult::AggregateResult()
+    : min(std::numeric_limits<double>::infinity()), max(-std::numeric_limits<double>::infinity()) {}
+
+double AggregateResult::mean() const {
+    return count > 0 ? sum / static_cast<double>(count) : std::numeric_limits<double>::quiet_NaN();
+}
+
+AggregateResult aggregate(const Expr& expr, const BatchColumns& columns, size_t rows, NumericPolicy policy,
+                          ThreadPool* pool) {
+    Metrics::add(Counter::BatchRows, rows);
+    size_t blocks = (rows + AGGREGATE_BLOCK - 1) / AGGREGATE_BLOCK;
+    std::vector<BlockTotals> partials(blocks);
+    auto run = [&](size_t first, size_t last) {
+        for (size_t b = first; b < last; ++b) {
+            size_t begin = b * AGGREGATE_BLOCK;
+            partials[b] = reduceBlock(expr, columns, begin, std::min(rows, begin + AGGREGATE_BLOCK), policy);
+        }
+    };
+    if (pool) {
+        pool->parallelFor(blocks, 1, run);
+    } else {
+        run(0, blocks);
+    }
+
+    // Combine in block order, never in completion order
+    BlockTotals total;
+    for (const BlockTotals& block : partials) {
+        total.sum.add(block.sum);
+        total.min = block.min < total.min ? block.min : total.min;
+        total.max = block.max > total.max ? block.max : total.max;
+        total.errors += block.errors;
+    }
+
+    AggregateResult result;
+    result.sum = total.sum.value();
+    result.min = total.min;
+    result.max = total.max;
+    result.errors = total.errors;
+    result.count = rows - total.errors;
+    return result;
+}
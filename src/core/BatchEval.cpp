@@ -0,0 +1,236 @@
+#include "core/AST.h"
+#include "core/Metrics.h"
+#include "core/Numeric.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Batch evaluation: every node evaluates a whole chunk of rows at a time into
+// caller-provided buffers. Loops have no data-dependent branches (conditionals
+// and short-circuit operators become selects), so they vectorize and do not
+// mispredict on random data. Errors are tracked per row with the same
+// first-error-wins order as the scalar evaluator.
+
+static constexpr double ERROR_VALUE = std::numeric_limits<double>::quiet_NaN();
+
+// Written with masks so the compiler emits selects rather than branches
+static inline EvalError firstError(EvalError first, EvalError second) {
+    unsigned char keep = static_cast<unsigned char>(-(first != EvalError::None));
+    return static_cast<EvalError>((static_cast<unsigned char>(first) & keep) |
+                                  (static_cast<unsigned char>(second) & ~keep));
+}
+
+// selectError(c, a, b) == (c ? a : b), without a branch
+static inline EvalError selectError(bool c, EvalError a, EvalError b) {
+    unsigned char mask = static_cast<unsigned char>(-c);
+    return static_cast<EvalError>((static_cast<unsigned char>(a) & mask) |
+                                  (static_cast<unsigned char>(b) & ~mask));
+}
+
+static void fillError(size_t n, double* out, EvalError* errors, EvalError error) {
+    std::fill(out, out + n, ERROR_VALUE);
+    std::fill(errors, errors + n, error);
+}
+
+// A scratch slot held for the lifetime of one evaluateChunk call
+class ScratchSlot {
+public:
+    explicit ScratchSlot(const BatchChunk& chunk) : scratch(*chunk.scratch), slot(scratch.acquire()) {}
+    ~ScratchSlot() { scratch.release(); }
+
+    ScratchSlot(const ScratchSlot&) = delete;
+    ScratchSlot& operator=(const ScratchSlot&) = delete;
+
+    double* values() { return slot.values; }
+    EvalError* errors() { return slot.errors; }
+
+private:
+    BatchScratch& scratch;
+    BatchScratch::Slot& slot;
+};
+
+// ---------------- Expr ----------------
+
+void Expr::evaluateBatch(const BatchColumns& columns, size_t rows, double* out, EvalError* errors,
+                         NumericPolicy policy) const {
+    Metrics::add(Counter::BatchRows, rows);
+    BatchScratch scratch;
+    for (size_t offset = 0; offset < rows; offset += BATCH_CHUNK) {
+        BatchChunk chunk{&columns, offset, std::min(BATCH_CHUNK, rows - offset), policy, &scratch};
+        evaluateChunk(chunk, out + offset, errors + offset);
+    }
+}
+
+// ---------------- NumberNode ----------------
+
+void NumberNode::evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const {
+    std::fill(out, out + chunk.count, value);
+    std::fill(errors, errors + chunk.count, EvalError::None);
+}
+
+// ---------------- BinaryOpNode ----------------
+
+// Applies `fn` elementwise: out[i] = fn(out[i], rhs[i])
+template <typename Fn>
+static inline void combine(size_t n, double* out, const double* rhs, Fn fn) {
+    for (size_t i = 0; i < n; ++i) out[i] = fn(out[i], rhs[i]);
+}
+
+// Division-style operators: a zero divisor is an error under the strict policy
+template <typename Fn>
+static inline void combineChecked(const BatchChunk& chunk, double* out, const double* rhs, EvalError* errors,
+                                  EvalError zeroError, Fn fn) {
+    const size_t n = chunk.count;
+    if (chunk.policy == NumericPolicy::Strict) {
+        for (size_t i = 0; i < n; ++i) {
+            errors[i] = firstError(errors[i], rhs[i] == 0 ? zeroError : EvalError::None);
+        }
+    }
+    combine(n, out, rhs, fn);
+}
+
+void BinaryOpNode::evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const {
+    const size_t n = chunk.count;
+    ScratchSlot rhsSlot(chunk);
+    double* rhs = rhsSlot.values();
+    EvalError* rhsErrors = rhsSlot.errors();
+
+    left->evaluateChunk(chunk, out, errors);
+    right->evaluateChunk(chunk, rhs, rhsErrors);
+    for (size_t i = 0; i < n; ++i) errors[i] = firstError(errors[i], rhsErrors[i]);
+
+    switch (op) {
+        case TokenType::PLUS:  combine(n, out, rhs, [](double a, double b) { return a + b; }); break;
+        case TokenType::MINUS: combine(n, out, rhs, [](double a, double b) { return a - b; }); break;
+        case TokenType::MUL:   combine(n, out, rhs, [](double a, double b) { return a * b; }); break;
+        case TokenType::DIV:
+            combineChecked(chunk, out, rhs, errors, EvalError::DivisionByZero,
+                           [](double a, double b) { return a / b; });
+            break;
+        case TokenType::MOD:
+            combineChecked(chunk, out, rhs, errors, EvalError::ModuloByZero,
+                           [](double a, double b) { return std::fmod(a, b); });
+            break;
+        case TokenType::POWER: combine(n, out, rhs, [](double a, double b) { return std::pow(a, b); }); break;
+
+        case TokenType::BIT_AND:
+            combine(n, out, rhs, [](double a, double b) -> double { return toInt(a) & toInt(b); });
+            break;
+        case TokenType::BIT_OR:
+            combine(n, out, rhs, [](double a, double b) -> double { return toInt(a) | toInt(b); });
+            break;
+        case TokenType::BIT_XOR:
+            combine(n, out, rhs, [](double a, double b) -> double { return toInt(a) ^ toInt(b); });
+            break;
+        case TokenType::LSHIFT:
+            combine(n, out, rhs, [](double a, double b) -> double { return shiftLeft(toInt(a), toInt(b)); });
+            break;
+        case TokenType::RSHIFT:
+            combine(n, out, rhs, [](double a, double b) -> double { return shiftRight(toInt(a), toInt(b)); });
+            break;
+
+        case TokenType::LESS:          combine(n, out, rhs, [](double a, double b) { return a < b ? 1.0 : 0.0; }); break;
+        case TokenType::LESS_EQUAL:    combine(n, out, rhs, [](double a, double b) { return a <= b ? 1.0 : 0.0; }); break;
+        case TokenType::GREATER:       combine(n, out, rhs, [](double a, double b) { return a > b ? 1.0 : 0.0; }); break;
+        case TokenType::GREATER_EQUAL: combine(n, out, rhs, [](double a, double b) { return a >= b ? 1.0 : 0.0; }); break;
+        case TokenType::EQUAL:         combine(n, out, rhs, [](double a, double b) { return a == b ? 1.0 : 0.0; }); break;
+        case TokenType::NOT_EQUAL:     combine(n, out, rhs, [](double a, double b) { return a != b ? 1.0 : 0.0; }); break;
+
+        default:
+            for (size_t i = 0; i < n; ++i) errors[i] = firstError(errors[i], EvalError::UnknownOperator);
+            break;
+    }
+}
+
+// ---------------- UnaryOpNode ----------------
+
+void UnaryOpNode::evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const {
+    const size_t n = chunk.count;
+    operand->evaluateChunk(chunk, out, errors);
+
+    switch (op) {
+        case TokenType::PLUS:
+            break;
+        case TokenType::MINUS:
+            for (size_t i = 0; i < n; ++i) out[i] = -out[i];
+            break;
+        case TokenType::BIT_NOT:
+            for (size_t i = 0; i < n; ++i) out[i] = ~toInt(out[i]);
+            break;
+        case TokenType::LOGICAL_NOT:
+            for (size_t i = 0; i < n; ++i) out[i] = out[i] == 0 ? 1.0 : 0.0;
+            break;
+        default:
+            for (size_t i = 0; i < n; ++i) errors[i] = firstError(errors[i], EvalError::UnknownOperator);
+            break;
+    }
+}
+
+// ---------------- LogicalOpNode ----------------
+// Both operands are evaluated for every row; the short-circuit only decides
+// whether the right operand's error counts for that row.
+
+void LogicalOpNode::evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const {
+    const size_t n = chunk.count;
+    ScratchSlot rhsSlot(chunk);
+    double* rhs = rhsSlot.values();
+    EvalError* rhsErrors = rhsSlot.errors();
+
+    left->evaluateChunk(chunk, out, errors);
+    right->evaluateChunk(chunk, rhs, rhsErrors);
+
+    if (op == TokenType::LOGICAL_AND) {
+        for (size_t i = 0; i < n; ++i) {
+            errors[i] = firstError(errors[i], selectError(out[i] != 0, rhsErrors[i], EvalError::None));
+        }
+        for (size_t i = 0; i < n; ++i) out[i] = ((out[i] != 0) & (rhs[i] != 0)) ? 1.0 : 0.0;
+    } else if (op == TokenType::LOGICAL_OR) {
+        for (size_t i = 0; i < n; ++i) {
+            errors[i] = firstError(errors[i], selectError(out[i] != 0, EvalError::None, rhsErrors[i]));
+        }
+        for (size_t i = 0; i < n; ++i) out[i] = ((out[i] != 0) | (rhs[i] != 0)) ? 1.0 : 0.0;
+    } else {
+        for (size_t i = 0; i < n; ++i) errors[i] = firstError(errors[i], EvalError::UnknownOperator);
+    }
+}
+
+// ---------------- ConditionalNode ----------------
+
+void ConditionalNode::evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const {
+    const size_t n = chunk.count;
+    ScratchSlot thenSlot(chunk);
+    ScratchSlot elseSlot(chunk);
+    double* thenValues = thenSlot.values();
+    double* elseValues = elseSlot.values();
+    EvalError* thenErrors = thenSlot.errors();
+    EvalError* elseErrors = elseSlot.errors();
+
+    cond->evaluateChunk(chunk, out, errors);
+    thenExpr->evaluateChunk(chunk, thenValues, thenErrors);
+    elseExpr->evaluateChunk(chunk, elseValues, elseErrors);
+
+    // Separate passes for errors and values keep each loop to one element width
+    for (size_t i = 0; i < n; ++i) {
+        errors[i] = firstError(errors[i], selectError(out[i] != 0, thenErrors[i], elseErrors[i]));
+    }
+    for (size_t i = 0; i < n; ++i) out[i] = out[i] != 0 ? thenValues[i] : elseValues[i];
+}
+
+// ---------------- VariableNode ----------------
+
+void VariableNode::evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const {
+    auto it = chunk.columns->find(name);
+    if (it == chunk.columns->end()) {
+        fillError(chunk.count, out, errors, EvalError::UndefinedVariable);
+        return;
+    }
+    const double* column = it->second + chunk.offset;
+    std::copy(column, column + chunk.count, out);
+    std::fill(errors, errors + chunk.count, EvalError::None);
+}
+
+// ---------------- AssignmentNode ----------------
+
+void AssignmentNode::evaluateChunk(const BatchChunk& chunk, double* out, EvalError* errors) const {
+    expr->evaluateChunk(chunk, out, errors);
+}
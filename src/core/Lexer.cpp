@@ -1,141 +1,214 @@
 #include "core/Lexer.h"
-#include <cctype>
+#include "core/CharClass.h"
+#include "core/Metrics.h"
+#include "core/NumberFormat.h"
+#include <charconv>
+#include <limits>
 #include <stdexcept>
 #include <string>
 
-Lexer::Lexer(const std::string& input) : input(input), pos(0) {}
+Lexer::Lexer(const std::string& input, ScanBackend backend)
+    : input(input), pos(0), scanner(&getScanner(backend)) {}
 
 char Lexer::currentChar() {
     if (pos >= input.length()) return '\0';
     return input[pos];
 }
 
+char Lexer::peekChar(size_t offset) {
+    if (pos + offset >= input.length()) return '\0';
+    return input[pos + offset];
+}
+
 void Lexer::advance() {
     pos++;
 }
 
 void Lexer::skipWhitespace() {
-    while (std::isspace(currentChar())) advance();
+    pos = scanner->skipSpaces(input.data(), pos, input.length());
 }
 
 Token Lexer::number() {
+    const char* data = input.data();
+    const size_t len = input.length();
     size_t startPos = pos;
+
+    // Hexadecimal literal: 0x1F
+    if (currentChar() == '0' && (peekChar(1) == 'x' || peekChar(1) == 'X') && isHexChar(peekChar(2))) {
+        pos += 2;
+        size_t digitsPos = pos;
+        while (isHexChar(currentChar())) advance();
+
+        unsigned long long val = 0;
+        auto res = std::from_chars(data + digitsPos, data + pos, val, 16);
+        if (res.ec != std::errc()) {
+            throw std::runtime_error("Number out of range: " + input.substr(startPos, pos - startPos));
+        }
+        if (val <= static_cast<unsigned long long>(std::numeric_limits<int>::max())) {
+            return Token(TokenType::NUMBER, static_cast<int>(val));
+        }
+        return Token(TokenType::NUMBER, static_cast<double>(val));
+    }
+
+    // digits [. digits] - a second decimal point ends the number
     bool hasDecimalPoint = false;
+    bool hasExponent = false;
 
-    while (true) {
-        char ch = currentChar();
-        if (std::isdigit(ch)) {
-            advance();
-        } else if (ch == '.') {
-            if (hasDecimalPoint) break;  // second decimal point - stop number
-            hasDecimalPoint = true;
-            advance();
-        } else {
-            break;
+    pos = scanner->skipDigits(data, pos, len);
+    if (currentChar() == '.') {
+        hasDecimalPoint = true;
+        pos = scanner->skipDigits(data, pos + 1, len);
+    }
+
+    // Exponent: only consumed when digits follow, so "2e" still lexes as 2 followed by identifier e
+    if (currentChar() == 'e' || currentChar() == 'E') {
+        size_t expOffset = 1;
+        if (peekChar(expOffset) == '+' || peekChar(expOffset) == '-') expOffset++;
+        if (isDigitChar(peekChar(expOffset))) {
+            hasExponent = true;
+            pos = scanner->skipDigits(data, pos + expOffset, len);
         }
     }
 
-    std::string numStr = input.substr(startPos, pos - startPos);
+    const char* first = data + startPos;
+    const char* last = data + pos;
 
-    if (hasDecimalPoint) {
-        double val = std::stod(numStr);
-        return Token(TokenType::NUMBER, val);
-    } else {
-        int val = std::stoi(numStr);
-        return Token(TokenType::NUMBER, val);
+    if (!hasDecimalPoint && !hasExponent) {
+        int val = 0;
+        auto res = std::from_chars(first, last, val);
+        if (res.ec == std::errc()) {
+            return Token(TokenType::NUMBER, val);
+        }
+        // Too large for int: fall through and keep it as a double
+    }
+
+    double val = 0.0;
+    if (!parseNumber(first, last, val)) {
+        throw std::runtime_error("Number out of range: " + input.substr(startPos, pos - startPos));
     }
+    return Token(TokenType::NUMBER, val);
 }
 
 Token Lexer::identifier() {
     size_t startPos = pos;
-    while (std::isalnum(currentChar()) || currentChar() == '_') {
-        advance();
-    }
-    std::string idStr = input.substr(startPos, pos - startPos);
-    return Token(TokenType::IDENTIFIER, idStr);
+    pos = scanner->skipIdentifier(input.data(), pos, input.length());
+    return Token(TokenType::IDENTIFIER, input.substr(startPos, pos - startPos));
 }
 
 std::vector<Token> Lexer::tokenize() {
+    StageScope scope(Stage::Lex);
     std::vector<Token> tokens;
+    tokens.reserve(input.length() / 4 + 1);  // typical formulas average more than 4 bytes per token
 
     while (true) {
         skipWhitespace();
         char ch = currentChar();
 
-        if (ch == '\0') {
-            tokens.emplace_back(TokenType::END);
-            break;
-        }
-        if (std::isalpha(ch) || ch == '_') {
+        // Identifiers and numbers are classified through the table; the rest dispatch on the character
+        if (isAlphaChar(ch) || ch == '_') {
             tokens.push_back(identifier());
-        } else if (std::isdigit(ch)) {
+            continue;
+        }
+        if (isDigitChar(ch)) {
             tokens.push_back(number());
-        } else if (ch == '+') {
-            tokens.emplace_back(TokenType::PLUS);
-            advance();
-        } else if (ch == '-') {
-            tokens.emplace_back(TokenType::MINUS);
-            advance();
-        } else if (ch == '*') {
-            advance(); // consume first '*'
-            if (currentChar() == '*') {
-                advance(); // consume second '*'
-                tokens.emplace_back(TokenType::POWER);
-            } else {
-                tokens.emplace_back(TokenType::MUL);
-            }
-        } else if (ch == '/') {
-            tokens.emplace_back(TokenType::DIV);
-            advance();
-        } else if (ch == '%') {
-            tokens.emplace_back(TokenType::MOD);
-            advance();
-        } else if (ch == '(') {
-            tokens.emplace_back(TokenType::LPAREN);
-            advance();
-        } else if (ch == ')') {
-            tokens.emplace_back(TokenType::RPAREN);
-            advance();
-        } else if (ch == ',') {
-            tokens.emplace_back(TokenType::COMMA);
-            advance();
-        } else if (ch == '=') {
-            tokens.emplace_back(TokenType::ASSIGN);
-            advance();
+            continue;
         }
-        // Bitwise operators and shifts
-        else if (ch == '&') {
-            tokens.emplace_back(TokenType::BIT_AND);
-            advance();
-        } else if (ch == '|') {
-            tokens.emplace_back(TokenType::BIT_OR);
-            advance();
-        } else if (ch == '^') {
-            tokens.emplace_back(TokenType::BIT_XOR);
-            advance();
-        } else if (ch == '~') {
-            tokens.emplace_back(TokenType::BIT_NOT);
-            advance();
-        } else if (ch == '<') {
-            advance();
-            if (currentChar() == '<') {
-                advance();
-                tokens.emplace_back(TokenType::LSHIFT);
-            } else {
-                throw std::runtime_error("Invalid token: expected '<' after '<'");
-            }
-        } else if (ch == '>') {
-            advance();
-            if (currentChar() == '>') {
-                advance();
-                tokens.emplace_back(TokenType::RSHIFT);
-            } else {
-                throw std::runtime_error("Invalid token: expected '>' after '>'");
-            }
-        } else {
-            throw std::runtime_error(std::string("Invalid character: ") + ch);
+
+        switch (ch) {
+            case '\0':
+                tokens.emplace_back(TokenType::END);
+                Metrics::add(Counter::TokensLexed, tokens.size());
+                scope.succeed();
+                return tokens;
+            case '+': tokens.emplace_back(TokenType::PLUS);   advance(); break;
+            case '-': tokens.emplace_back(TokenType::MINUS);  advance(); break;
+            case '/': tokens.emplace_back(TokenType::DIV);    advance(); break;
+            case '%': tokens.emplace_back(TokenType::MOD);    advance(); break;
+            case '(': tokens.emplace_back(TokenType::LPAREN); advance(); break;
+            case ')': tokens.emplace_back(TokenType::RPAREN); advance(); break;
+            case ',': tokens.emplace_back(TokenType::COMMA);  advance(); break;
+            case '*':
+                if (peekChar(1) == '*') {
+                    tokens.emplace_back(TokenType::POWER);
+                    pos += 2;
+                } else {
+                    tokens.emplace_back(TokenType::MUL);
+                    advance();
+                }
+                break;
+
+            // Bitwise operators and shifts, and their logical counterparts
+            case '&':
+                if (peekChar(1) == '&') {
+                    tokens.emplace_back(TokenType::LOGICAL_AND);
+                    pos += 2;
+                } else {
+                    tokens.emplace_back(TokenType::BIT_AND);
+                    advance();
+                }
+                break;
+            case '|':
+                if (peekChar(1) == '|') {
+                    tokens.emplace_back(TokenType::LOGICAL_OR);
+                    pos += 2;
+                } else {
+                    tokens.emplace_back(TokenType::BIT_OR);
+                    advance();
+                }
+                break;
+            case '^': tokens.emplace_back(TokenType::BIT_XOR); advance(); break;
+            case '~': tokens.emplace_back(TokenType::BIT_NOT); advance(); break;
+
+            // Shifts and comparisons
+            case '<':
+                if (peekChar(1) == '<') {
+                    tokens.emplace_back(TokenType::LSHIFT);
+                    pos += 2;
+                } else if (peekChar(1) == '=') {
+                    tokens.emplace_back(TokenType::LESS_EQUAL);
+                    pos += 2;
+                } else {
+                    tokens.emplace_back(TokenType::LESS);
+                    advance();
+                }
+                break;
+            case '>':
+                if (peekChar(1) == '>') {
+                    tokens.emplace_back(TokenType::RSHIFT);
+                    pos += 2;
+                } else if (peekChar(1) == '=') {
+                    tokens.emplace_back(TokenType::GREATER_EQUAL);
+                    pos += 2;
+                } else {
+                    tokens.emplace_back(TokenType::GREATER);
+                    advance();
+                }
+                break;
+            case '=':
+                if (peekChar(1) == '=') {
+                    tokens.emplace_back(TokenType::EQUAL);
+                    pos += 2;
+                } else {
+                    tokens.emplace_back(TokenType::ASSIGN);
+                    advance();
+                }
+                break;
+            case '!':
+                if (peekChar(1) == '=') {
+                    tokens.emplace_back(TokenType::NOT_EQUAL);
+                    pos += 2;
+                } else {
+                    tokens.emplace_back(TokenType::LOGICAL_NOT);
+                    advance();
+                }
+                break;
+
+            // Conditional operator
+            case '?': tokens.emplace_back(TokenType::QUESTION); advance(); break;
+            case ':': tokens.emplace_back(TokenType::COLON);    advance(); break;
+
+            default:
+                throw std::runtime_error(std::string("Invalid character: ") + ch);
         }
     }
-
-    return tokens;
 }
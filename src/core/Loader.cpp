@@ -0,0 +1,164 @@
+#include "core/Loader.h"
+#include "core/Lexer.h"
+#include "core/Parser.h"
+#include <algorithm>
+#include <unordered_map>
+
+// Statements per work item; parsing one is only a few microseconds
+constexpr size_t PARSE_GRAIN = 256;
+constexpr size_t EVAL_GRAIN = 512;
+
+// Waves smaller than this are evaluated inline instead of waking the pool
+constexpr size_t MIN_PARALLEL_WAVE = 2048;
+
+Loader::Loader(unsigned threads) : pool(threads) {}
+
+static void dedupe(std::vector<std::string>& names) {
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+}
+
+std::vector<Statement> Loader::parse(const std::string& text) {
+    // Split on newlines, skipping blank lines
+    std::vector<Statement> statements;
+    size_t lineNo = 0;
+    for (size_t start = 0; start <= text.size();) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size();
+        ++lineNo;
+
+        size_t first = text.find_first_not_of(" \t\r", start);
+        if (first != std::string::npos && first < end) {
+            size_t last = text.find_last_not_of(" \t\r", end - 1);
+            Statement st;
+            st.line = lineNo;
+            st.source = text.substr(first, last - first + 1);
+            statements.push_back(std::move(st));
+        }
+        start = end + 1;
+    }
+
+    pool.parallelFor(statements.size(), PARSE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Statement& st = statements[i];
+            try {
+                Lexer lexer(st.source);
+                Parser parser(lexer.tokenize());
+                st.ast = parser.parse();
+                st.ast->collectVariables(st.reads, st.writes);
+                dedupe(st.reads);
+                dedupe(st.writes);
+            } catch (const std::exception& ex) {
+                st.ast.reset();
+                st.error = ex.what();
+            }
+        }
+    });
+
+    return statements;
+}
+
+// True if the statement assigns a variable that it also reads and that does not exist yet
+static bool readsMissingWrite(const Statement& st, const VarContext& context) {
+    for (const auto& name : st.writes) {
+        if (std::binary_search(st.reads.begin(), st.reads.end(), name) && context.find(name) == context.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<StatementResult> Loader::evaluate(const std::vector<Statement>& statements, VarContext& context) {
+    std::vector<StatementResult> results(statements.size());
+
+    auto evalOne = [&](size_t i) {
+        const Statement& st = statements[i];
+        if (!st.ast) {
+            results[i].error = st.error;
+            return;
+        }
+        EvalResult r = st.ast->tryEvaluate(context);
+        results[i].ok = r.ok();
+        results[i].value = r.value;
+        if (!r.ok()) results[i].error = r.message();
+    };
+
+    // Single thread: plain source order, no scheduling needed
+    if (pool.size() == 1) {
+        for (size_t i = 0; i < statements.size(); ++i) evalOne(i);
+        return results;
+    }
+
+    // Assign each statement the earliest wave after every earlier statement it
+    // conflicts with: read-after-write, write-after-write and write-after-read
+    struct VarWaves { long lastWrite = -1; long lastRead = -1; };
+    std::unordered_map<std::string, VarWaves> vars;
+    vars.reserve(statements.size());
+    std::vector<std::vector<size_t>> waves;
+
+    for (size_t i = 0; i < statements.size(); ++i) {
+        const Statement& st = statements[i];
+        long wave = 0;
+        for (const auto& name : st.reads) {
+            auto it = vars.find(name);
+            if (it != vars.end()) wave = std::max(wave, it->second.lastWrite + 1);
+        }
+        for (const auto& name : st.writes) {
+            auto it = vars.find(name);
+            if (it != vars.end()) wave = std::max({wave, it->second.lastWrite + 1, it->second.lastRead + 1});
+        }
+        for (const auto& name : st.reads) {
+            auto& v = vars[name];
+            v.lastRead = std::max(v.lastRead, wave);
+        }
+        for (const auto& name : st.writes) vars[name].lastWrite = wave;
+
+        if (static_cast<size_t>(wave) >= waves.size()) waves.resize(wave + 1);
+        waves[wave].push_back(i);
+    }
+
+    std::vector<std::pair<size_t, std::string>> placeholders;
+    std::vector<size_t> parallel;
+    for (const auto& wave : waves) {
+        if (wave.size() < MIN_PARALLEL_WAVE) {
+            for (size_t i : wave) evalOne(i);
+            continue;
+        }
+
+        // A statement that reads a variable it assigns would see the placeholder
+        // below instead of an undefined variable, so it runs first, on its own
+        parallel.clear();
+        for (size_t i : wave) {
+            if (readsMissingWrite(statements[i], context)) {
+                evalOne(i);
+            } else {
+                parallel.push_back(i);
+            }
+        }
+
+        // Insert every variable this wave assigns up front, so workers only ever
+        // overwrite existing entries and the table is never rehashed concurrently.
+        // No other statement in the wave reads them, so the placeholders are unobservable.
+        placeholders.clear();
+        for (size_t i : parallel) {
+            for (const auto& name : statements[i].writes) {
+                if (context.emplace(name, 0.0).second) placeholders.emplace_back(i, name);
+            }
+        }
+
+        pool.parallelFor(parallel.size(), EVAL_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) evalOne(parallel[k]);
+        });
+
+        // A failed assignment never stores, so drop the placeholders it left behind
+        for (const auto& [i, name] : placeholders) {
+            if (!results[i].ok) context.erase(name);
+        }
+    }
+
+    return results;
+}
+
+std::vector<StatementResult> Loader::run(const std::string& text, VarContext& context) {
+    return evaluate(parse(text), context);
+}
@@ -0,0 +1,389 @@
+#include "core/Metrics.h"
+#include "core/NumberFormat.h"
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+constexpr size_t COUNTERS = static_cast<size_t>(Counter::Count);
+constexpr size_t STAGES = static_cast<size_t>(Stage::Count);
+constexpr size_t BUCKETS = LatencyHistogram::BUCKETS;
+
+std::atomic<uint32_t> Metrics::flagWord{0};
+
+static std::atomic<uint32_t> sampleInterval{256};
+
+static const char* const STAGE_NAMES[STAGES] = {"lex", "parse", "evaluate"};
+
+// Counters exported as miniexpr_<name>_total; the rest are error kinds
+constexpr size_t FIRST_ERROR_COUNTER = static_cast<size_t>(Counter::LexErrors);
+static const char* const COUNTER_NAMES[COUNTERS] = {
+    "tokens_lexed", "nodes_parsed", "evaluations", "batch_rows",
+    "lex", "parse", "division_by_zero", "modulo_by_zero", "undefined_variable", "unknown_operator", "eval_limit",
+};
+static const char* const COUNTER_HELP[FIRST_ERROR_COUNTER] = {
+    "Tokens produced by the lexer.",
+    "AST nodes built by the parser.",
+    "Single-row evaluations.",
+    "Rows evaluated by batch and aggregate evaluation.",
+};
+
+// ---------------- Per-thread storage ----------------
+
+struct TraceEvent {
+    Stage stage;
+    uint64_t startNanos;  // since the trace started
+    uint64_t durationNanos;
+    uint32_t tid;
+};
+
+// Written only by its own thread; other threads read it while merging, hence the
+// relaxed atomics (plain loads and stores on x86, no read-modify-write). Counts
+// only grow: reset() records a baseline that merging subtracts instead of
+// writing to them, which would race with the owner's load-add-store.
+struct ThreadMetrics {
+    std::atomic<uint64_t> counters[COUNTERS] = {};
+    std::atomic<uint64_t> buckets[STAGES][BUCKETS] = {};
+    std::atomic<uint64_t> samples[STAGES] = {};
+    std::atomic<uint64_t> sumNanos[STAGES] = {};
+    ThreadHotMetrics* hot = nullptr;  // the owning thread's threadHotMetrics
+    MetricsSnapshot baseline;         // totals at the last reset(), guarded by the registry mutex
+    uint32_t tid = 0;
+
+    std::mutex traceMutex;  // only taken while tracing
+    std::vector<TraceEvent> trace;
+};
+
+static inline void bump(std::atomic<uint64_t>& a, uint64_t n) {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadMetrics*> live;
+    MetricsSnapshot retired;               // totals of threads that have exited
+    std::vector<TraceEvent> retiredTrace;  // their trace events
+    uint32_t nextTid = 1;
+
+    std::atomic<size_t> traceEvents{0};
+    std::atomic<uint64_t> droppedEvents{0};
+    std::atomic<int64_t> traceEpochNanos{0};  // steady_clock time the trace started
+};
+
+static Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+constexpr size_t EVALUATE = static_cast<size_t>(Stage::Evaluate);
+constexpr size_t EVALUATIONS = static_cast<size_t>(Counter::Evaluations);
+
+// Evaluations since the thread's last sample, not yet in its counters. Read
+// while the owner restarts the countdown, the pair can be momentarily
+// inconsistent; that must not wrap around.
+static uint64_t pendingEvaluations(const ThreadMetrics& m) {
+    uint32_t period = m.hot->period[EVALUATE].load(std::memory_order_relaxed);
+    uint32_t countdown = m.hot->countdown[EVALUATE].load(std::memory_order_relaxed);
+    return period > countdown ? period - countdown : 0;
+}
+
+// Everything the thread has counted since it started
+static MetricsSnapshot threadTotals(const ThreadMetrics& m) {
+    MetricsSnapshot out;
+    for (size_t c = 0; c < COUNTERS; ++c) out.counters[c] = m.counters[c].load(std::memory_order_relaxed);
+    out.counters[EVALUATIONS] += pendingEvaluations(m);
+    for (size_t s = 0; s < STAGES; ++s) {
+        LatencyHistogram& h = out.stages[s];
+        for (size_t b = 0; b < BUCKETS; ++b) h.buckets[b] = m.buckets[s][b].load(std::memory_order_relaxed);
+        h.count = m.samples[s].load(std::memory_order_relaxed);
+        h.sumNanos = m.sumNanos[s].load(std::memory_order_relaxed);
+    }
+    return out;
+}
+
+// out += total - base, each field clamped at 0 (see pendingEvaluations)
+static void addSince(MetricsSnapshot& out, const MetricsSnapshot& total, const MetricsSnapshot& base) {
+    auto since = [](uint64_t now, uint64_t then) { return now > then ? now - then : 0; };
+    for (size_t c = 0; c < COUNTERS; ++c) out.counters[c] += since(total.counters[c], base.counters[c]);
+    for (size_t s = 0; s < STAGES; ++s) {
+        LatencyHistogram& h = out.stages[s];
+        for (size_t b = 0; b < BUCKETS; ++b) h.buckets[b] += since(total.stages[s].buckets[b], base.stages[s].buckets[b]);
+        h.count += since(total.stages[s].count, base.stages[s].count);
+        h.sumNanos += since(total.stages[s].sumNanos, base.stages[s].sumNanos);
+    }
+}
+
+// Adds what the thread counted since the last reset(); needs the registry mutex
+static void addInto(MetricsSnapshot& out, const ThreadMetrics& m) {
+    addSince(out, threadTotals(m), m.baseline);
+}
+
+// Folds an exiting thread's metrics into the registry
+struct ThreadSlot {
+    ThreadMetrics* metrics = nullptr;
+
+    ~ThreadSlot() {
+        if (!metrics) return;
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        addInto(reg.retired, *metrics);
+        reg.retiredTrace.insert(reg.retiredTrace.end(), metrics->trace.begin(), metrics->trace.end());
+        reg.live.erase(std::find(reg.live.begin(), reg.live.end(), metrics));
+        delete metrics;
+        metrics = nullptr;
+    }
+};
+
+// The plain pointer makes the hot-path lookup a single thread-local load; the
+// slot, which needs a guarded constructor/destructor, is only touched once per thread
+static thread_local ThreadMetrics* currentMetrics = nullptr;
+
+static ThreadMetrics& registerThread() {
+    thread_local ThreadSlot slot;
+    auto* m = new ThreadMetrics();
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    m->tid = reg.nextTid++;
+    m->hot = &threadHotMetrics;
+    reg.live.push_back(m);
+    slot.metrics = m;
+    currentMetrics = m;
+    return *m;
+}
+
+static inline ThreadMetrics& localMetrics() {
+    ThreadMetrics* m = currentMetrics;
+    return m ? *m : registerThread();
+}
+
+// ---------------- LatencyHistogram ----------------
+
+static size_t bucketOf(uint64_t nanos) {
+    size_t b = 63 - static_cast<size_t>(__builtin_clzll(nanos | 1));
+    return std::min(b, BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::quantileNanos(double q) const {
+    if (count == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(q * static_cast<double>(count));
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; ++b) {
+        seen += buckets[b];
+        if (seen >= target) return uint64_t(1) << (b + 1);
+    }
+    return uint64_t(1) << BUCKETS;
+}
+
+// ---------------- Metrics ----------------
+
+void Metrics::setSampleInterval(uint32_t interval) {
+    sampleInterval.store(std::max<uint32_t>(interval, 1), std::memory_order_relaxed);
+}
+
+void Metrics::addSlow(Counter c, uint64_t n) {
+    bump(localMetrics().counters[static_cast<size_t>(c)], n);
+}
+
+MetricsSnapshot Metrics::snapshot() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    MetricsSnapshot result = reg.retired;
+    for (const ThreadMetrics* m : reg.live) addInto(result, *m);
+    return result;
+}
+
+void Metrics::reset() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.retired = MetricsSnapshot();
+    for (ThreadMetrics* m : reg.live) m->baseline = threadTotals(*m);
+}
+
+static std::string seconds(uint64_t nanos) {
+    return formatNumber(static_cast<double>(nanos) * 1e-9);
+}
+
+std::string Metrics::toPrometheus(const MetricsSnapshot& snap) {
+    std::string out;
+    for (size_t c = 0; c < FIRST_ERROR_COUNTER; ++c) {
+        std::string name = std::string("miniexpr_") + COUNTER_NAMES[c] + "_total";
+        out += "# HELP " + name + " " + COUNTER_HELP[c] + "\n";
+        out += "# TYPE " + name + " counter\n";
+        out += name + " " + std::to_string(snap.counters[c]) + "\n";
+    }
+
+    out += "# HELP miniexpr_errors_total Errors by kind.\n";
+    out += "# TYPE miniexpr_errors_total counter\n";
+    for (size_t c = FIRST_ERROR_COUNTER; c < COUNTERS; ++c) {
+        out += std::string("miniexpr_errors_total{kind=\"") + COUNTER_NAMES[c] + "\"} " +
+               std::to_string(snap.counters[c]) + "\n";
+    }
+
+    out += "# HELP miniexpr_stage_latency_seconds Sampled latency of each pipeline stage.\n";
+    out += "# TYPE miniexpr_stage_latency_seconds histogram\n";
+    for (size_t s = 0; s < STAGES; ++s) {
+        const LatencyHistogram& h = snap.stages[s];
+        std::string label = std::string("stage=\"") + STAGE_NAMES[s] + "\"";
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            cumulative += h.buckets[b];
+            out += "miniexpr_stage_latency_seconds_bucket{" + label + ",le=\"" + seconds(uint64_t(1) << (b + 1)) +
+                   "\"} " + std::to_string(cumulative) + "\n";
+        }
+        out += "miniexpr_stage_latency_seconds_bucket{" + label + ",le=\"+Inf\"} " + std::to_string(h.count) + "\n";
+        out += "miniexpr_stage_latency_seconds_sum{" + label + "} " + seconds(h.sumNanos) + "\n";
+        out += "miniexpr_stage_latency_seconds_count{" + label + "} " + std::to_string(h.count) + "\n";
+    }
+    return out;
+}
+
+std::string Metrics::toJson(const MetricsSnapshot& snap) {
+    std::string out = "{\"counters\":{";
+    for (size_t c = 0; c < FIRST_ERROR_COUNTER; ++c) {
+        if (c > 0) out += ',';
+        out += std::string("\"") + COUNTER_NAMES[c] + "\":" + std::to_string(snap.counters[c]);
+    }
+    out += "},\"errors\":{";
+    for (size_t c = FIRST_ERROR_COUNTER; c < COUNTERS; ++c) {
+        if (c > FIRST_ERROR_COUNTER) out += ',';
+        out += std::string("\"") + COUNTER_NAMES[c] + "\":" + std::to_string(snap.counters[c]);
+    }
+    out += "},\"stages\":{";
+    for (size_t s = 0; s < STAGES; ++s) {
+        const LatencyHistogram& h = snap.stages[s];
+        if (s > 0) out += ',';
+        out += std::string("\"") + STAGE_NAMES[s] + "\":{\"samples\":" + std::to_string(h.count) +
+               ",\"sum_ns\":" + std::to_string(h.sumNanos) +
+               ",\"p50_ns\":" + std::to_string(h.quantileNanos(0.50)) +
+               ",\"p99_ns\":" + std::to_string(h.quantileNanos(0.99)) + ",\"buckets\":[";
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            if (b > 0) out += ',';
+            out += std::to_string(h.buckets[b]);
+        }
+        out += "]}";
+    }
+    out += "}}";
+    return out;
+}
+
+// ---------------- Tracing ----------------
+
+void Metrics::startTrace() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (ThreadMetrics* m : reg.live) {
+        std::lock_guard<std::mutex> traceLock(m->traceMutex);
+        m->trace.clear();
+    }
+    reg.retiredTrace.clear();
+    reg.traceEvents.store(0);
+    reg.droppedEvents.store(0);
+    reg.traceEpochNanos.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    flagWord.fetch_or(TRACING);
+}
+
+void Metrics::stopTrace() {
+    flagWord.fetch_and(~TRACING);
+}
+
+std::string Metrics::traceJson() {
+    Registry& reg = registry();
+    std::vector<TraceEvent> events;
+    uint64_t dropped;
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        events = reg.retiredTrace;
+        for (ThreadMetrics* m : reg.live) {
+            std::lock_guard<std::mutex> traceLock(m->traceMutex);
+            events.insert(events.end(), m->trace.begin(), m->trace.end());
+        }
+        dropped = reg.droppedEvents.load();
+    }
+    std::sort(events.begin(), events.end(),
+              [](const TraceEvent& a, const TraceEvent& b) { return a.startNanos < b.startNanos; });
+
+    // Trace-event timestamps are microseconds; keep the nanosecond fraction
+    std::string out = "{\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); ++i) {
+        const TraceEvent& e = events[i];
+        if (i > 0) out += ",\n";
+        out += std::string("{\"name\":\"") + STAGE_NAMES[static_cast<size_t>(e.stage)] +
+               "\",\"cat\":\"pipeline\",\"ph\":\"X\",\"ts\":" + formatNumber(e.startNanos / 1000.0) +
+               ",\"dur\":" + formatNumber(e.durationNanos / 1000.0) + ",\"pid\":1,\"tid\":" + std::to_string(e.tid) + "}";
+    }
+    out += "],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":" + std::to_string(dropped) + "}}\n";
+    return out;
+}
+
+bool Metrics::writeTrace(const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::string json = traceJson();
+    file.write(json.data(), json.size());
+    return static_cast<bool>(file);
+}
+
+// ---------------- StageScope ----------------
+
+// Slow path of the constructor: a sampled call, or every call while tracing.
+// A sample also settles the calls counted down since the previous one.
+void StageScope::begin(uint32_t flags) {
+    ThreadHotMetrics& hot = threadHotMetrics;
+    size_t s = static_cast<size_t>(stage);
+    if ((flags & Metrics::ENABLED) && hot.countdown[s].load(std::memory_order_relaxed) == 0) {
+        ThreadMetrics& m = localMetrics();  // registers the thread on its first call
+        uint32_t calls = hot.period[s].load(std::memory_order_relaxed);
+        uint32_t interval = sampleInterval.load(std::memory_order_relaxed);
+        hot.period[s].store(interval, std::memory_order_relaxed);
+        hot.countdown[s].store(interval, std::memory_order_relaxed);
+        if (s == EVALUATE) bump(m.counters[EVALUATIONS], calls);
+        timed = true;
+    }
+    if (flags & Metrics::TRACING) timed = true;
+    if (timed) start = Clock::now();
+}
+
+// Error kind of a completed evaluation
+static Counter errorCounter(EvalError error) {
+    switch (error) {
+        case EvalError::DivisionByZero:    return Counter::DivisionByZero;
+        case EvalError::ModuloByZero:      return Counter::ModuloByZero;
+        case EvalError::UndefinedVariable: return Counter::UndefinedVariable;
+        default:                           return Counter::UnknownOperator;
+    }
+}
+
+void StageScope::end() {
+    ThreadMetrics& m = localMetrics();
+    size_t s = static_cast<size_t>(stage);
+    bool enabled = Metrics::enabled();
+
+    if (enabled && !succeeded) {
+        static const Counter STAGE_ERRORS[STAGES] = {Counter::LexErrors, Counter::ParseErrors, Counter::EvalLimitErrors};
+        bump(m.counters[static_cast<size_t>(STAGE_ERRORS[s])], 1);
+    }
+    if (enabled && error != EvalError::None) bump(m.counters[static_cast<size_t>(errorCounter(error))], 1);
+    if (!timed) return;
+
+    Clock::time_point finish = Clock::now();
+    uint64_t nanos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count());
+    if (enabled) {
+        bump(m.buckets[s][bucketOf(nanos)], 1);
+        bump(m.samples[s], 1);
+        bump(m.sumNanos[s], nanos);
+    }
+
+    if (Metrics::tracing()) {
+        Registry& reg = registry();
+        if (reg.traceEvents.fetch_add(1, std::memory_order_relaxed) >= Metrics::MAX_TRACE_EVENTS) {
+            reg.droppedEvents.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        int64_t since = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count() -
+                        reg.traceEpochNanos.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(m.traceMutex);
+        m.trace.push_back(TraceEvent{stage, static_cast<uint64_t>(std::max<int64_t>(since, 0)), nanos, m.tid});
+    }
+}
@@ -0,0 +1,26 @@
+#include "core/NumberFormat.h"
+#include <charconv>
+#include <cmath>
+#include <system_error>
+
+char* formatNumber(double value, char* first, char* last) {
+    // Integral values print like integers; -0.0 goes through the double path to keep its sign
+    if (std::fabs(value) < 1e15 && value == std::trunc(value) && !(value == 0 && std::signbit(value))) {
+        auto res = std::to_chars(first, last, static_cast<long long>(value));
+        if (res.ec == std::errc()) return res.ptr;
+    }
+    auto res = std::to_chars(first, last, value);
+    if (res.ec != std::errc()) return first;  // only possible if the buffer is too small
+    return res.ptr;
+}
+
+std::string formatNumber(double value) {
+    char buf[NUMBER_BUFFER_SIZE];
+    char* end = formatNumber(value, buf, buf + sizeof(buf));
+    return std::string(buf, end);
+}
+
+bool parseNumber(const char* first, const char* last, double& out) {
+    auto res = std::from_chars(first, last, out, std::chars_format::general);
+    return res.ec == std::errc() && res.ptr == last;
+}
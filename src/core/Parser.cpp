@@ -1,10 +1,48 @@
 #include "core/Parser.h"
+#include "core/Metrics.h"
+#include "core/Sandbox.h"
+#include <algorithm>
 #include <stdexcept>
 #include <variant>
 #include <string>
+#include <utility>
 
 // Constructor unchanged
-Parser::Parser(const std::vector<Token>& tokens) : tokens(tokens), pos(0) {}
+Parser::Parser(const std::vector<Token>& tokens, const ParseLimits& limits)
+    : tokens(tokens), pos(0), limits(limits) {}
+
+Parser::Parser(std::vector<Token>&& tokens, const ParseLimits& limits)
+    : tokens(std::move(tokens)), pos(0), limits(limits) {}
+
+// Tracks recursion depth for the rules that can nest without bound
+struct Parser::DepthGuard {
+    size_t& depth;
+
+    DepthGuard(size_t& depth, size_t maxDepth) : depth(depth) {
+        if (depth >= maxDepth) throw depthError(maxDepth);
+        ++depth;
+    }
+    ~DepthGuard() { --depth; }
+
+    static SandboxError depthError(size_t maxDepth) {
+        return SandboxError(SandboxError::Kind::DepthLimit,
+                            "Expression nesting exceeds " + std::to_string(maxDepth) + " levels");
+    }
+};
+
+// childHeight is the height of the node's tallest child (0 for leaves). Recursion
+// depth alone misses the left-deep trees built by the loops of the binary rules,
+// so the height of every node is checked as well.
+template <typename Node, typename... Args>
+std::unique_ptr<Expr> Parser::makeNode(size_t childHeight, Args&&... args) {
+    if (++nodeCount > limits.maxNodes) {
+        throw SandboxError(SandboxError::Kind::NodeLimit,
+                           "Expression exceeds " + std::to_string(limits.maxNodes) + " nodes");
+    }
+    if (childHeight >= limits.maxDepth) throw DepthGuard::depthError(limits.maxDepth);
+    height = childHeight + 1;
+    return std::make_unique<Node>(std::forward<Args>(args)...);
+}
 
 const Token& Parser::currentToken() const {
     if (pos >= tokens.size()) throw std::runtime_error("Unexpected end of input");
@@ -17,14 +55,18 @@ void Parser::advance() {
 
 // Entry point: parse assignment or expression, expect end of input
 std::unique_ptr<Expr> Parser::parse() {
+    StageScope scope(Stage::Parse);
     auto result = assignment();  // Parse assignment first
     if (currentToken().type != TokenType::END)
         throw std::runtime_error("Unexpected token after expression");
+    Metrics::add(Counter::NodesParsed, nodeCount);
+    scope.succeed();
     return result;
 }
 
-// assignment → IDENTIFIER '=' assignment | expr
+// assignment → IDENTIFIER '=' assignment | conditional
 std::unique_ptr<Expr> Parser::assignment() {
+    DepthGuard guard(depth, limits.maxDepth);
     if (currentToken().type == TokenType::IDENTIFIER) {
         // Lookahead for '=' token
         if ((pos + 1) < tokens.size() && tokens[pos + 1].type == TokenType::ASSIGN) {
@@ -32,11 +74,82 @@ std::unique_ptr<Expr> Parser::assignment() {
             advance();  // consume identifier
             advance();  // consume '='
             auto right = assignment();  // right recursive for chained assignments
-            return std::make_unique<AssignmentNode>(varName, std::move(right));
+            return makeNode<AssignmentNode>(height, varName, std::move(right));
         }
     }
     // No assignment detected, parse normal expression
-    return expr();
+    return conditional();
+}
+
+// conditional → logical_or ('?' conditional ':' conditional)?
+std::unique_ptr<Expr> Parser::conditional() {
+    auto cond = logical_or();
+    if (currentToken().type != TokenType::QUESTION) return cond;
+    size_t childHeight = height;
+    advance();
+
+    DepthGuard guard(depth, limits.maxDepth);
+    auto thenExpr = conditional();
+    childHeight = std::max(childHeight, height);
+    if (currentToken().type != TokenType::COLON)
+        throw std::runtime_error("Expected ':' in conditional expression");
+    advance();
+    auto elseExpr = conditional();  // right recursion: a ? b : c ? d : e
+    childHeight = std::max(childHeight, height);
+    return makeNode<ConditionalNode>(childHeight, std::move(cond), std::move(thenExpr), std::move(elseExpr));
+}
+
+// logical_or → logical_and (|| logical_and)*
+std::unique_ptr<Expr> Parser::logical_or() {
+    auto left = logical_and();
+    while (currentToken().type == TokenType::LOGICAL_OR) {
+        TokenType op = currentToken().type;
+        size_t leftHeight = height;
+        advance();
+        auto right = logical_and();
+        left = makeNode<LogicalOpNode>(std::max(leftHeight, height), op, std::move(left), std::move(right));
+    }
+    return left;
+}
+
+// logical_and → equality (&& equality)*
+std::unique_ptr<Expr> Parser::logical_and() {
+    auto left = equality();
+    while (currentToken().type == TokenType::LOGICAL_AND) {
+        TokenType op = currentToken().type;
+        size_t leftHeight = height;
+        advance();
+        auto right = equality();
+        left = makeNode<LogicalOpNode>(std::max(leftHeight, height), op, std::move(left), std::move(right));
+    }
+    return left;
+}
+
+// equality → comparison ((==|!=) comparison)*
+std::unique_ptr<Expr> Parser::equality() {
+    auto left = comparison();
+    while (currentToken().type == TokenType::EQUAL || currentToken().type == TokenType::NOT_EQUAL) {
+        TokenType op = currentToken().type;
+        size_t leftHeight = height;
+        advance();
+        auto right = comparison();
+        left = makeNode<BinaryOpNode>(std::max(leftHeight, height), op, std::move(left), std::move(right));
+    }
+    return left;
+}
+
+// comparison → expr ((<|<=|>|>=) expr)*
+std::unique_ptr<Expr> Parser::comparison() {
+    auto left = expr();
+    while (currentToken().type == TokenType::LESS || currentToken().type == TokenType::LESS_EQUAL ||
+           currentToken().type == TokenType::GREATER || currentToken().type == TokenType::GREATER_EQUAL) {
+        TokenType op = currentToken().type;
+        size_t leftHeight = height;
+        advance();
+        auto right = expr();
+        left = makeNode<BinaryOpNode>(std::max(leftHeight, height), op, std::move(left), std::move(right));
+    }
+    return left;
 }
 
 // expr → term ((+|-) term)*
@@ -44,9 +157,10 @@ std::unique_ptr<Expr> Parser::expr() {
     auto left = term();
     while (currentToken().type == TokenType::PLUS || currentToken().type == TokenType::MINUS) {
         TokenType op = currentToken().type;
+        size_t leftHeight = height;
         advance();
         auto right = term();
-        left = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        left = makeNode<BinaryOpNode>(std::max(leftHeight, height), op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -56,9 +170,10 @@ std::unique_ptr<Expr> Parser::term() {
     auto left = bitwise_or();
     while (currentToken().type == TokenType::MUL || currentToken().type == TokenType::DIV || currentToken().type == TokenType::MOD) {
         TokenType op = currentToken().type;
+        size_t leftHeight = height;
         advance();
         auto right = bitwise_or();
-        left = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        left = makeNode<BinaryOpNode>(std::max(leftHeight, height), op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -68,9 +183,10 @@ std::unique_ptr<Expr> Parser::bitwise_or() {
     auto left = bitwise_xor();
     while (currentToken().type == TokenType::BIT_OR) {
         TokenType op = currentToken().type;
+        size_t leftHeight = height;
         advance();
         auto right = bitwise_xor();
-        left = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        left = makeNode<BinaryOpNode>(std::max(leftHeight, height), op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -80,9 +196,10 @@ std::unique_ptr<Expr> Parser::bitwise_xor() {
     auto left = bitwise_and();
     while (currentToken().type == TokenType::BIT_XOR) {
         TokenType op = currentToken().type;
+        size_t leftHeight = height;
         advance();
         auto right = bitwise_and();
-        left = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        left = makeNode<BinaryOpNode>(std::max(leftHeight, height), op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -92,9 +209,10 @@ std::unique_ptr<Expr> Parser::bitwise_and() {
     auto left = shift();
     while (currentToken().type == TokenType::BIT_AND) {
         TokenType op = currentToken().type;
+        size_t leftHeight = height;
         advance();
         auto right = shift();
-        left = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        left = makeNode<BinaryOpNode>(std::max(leftHeight, height), op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -104,9 +222,10 @@ std::unique_ptr<Expr> Parser::shift() {
     auto left = power();   // <-- FIX: previously was factor(), now power()
     while (currentToken().type == TokenType::LSHIFT || currentToken().type == TokenType::RSHIFT) {
         TokenType op = currentToken().type;
+        size_t leftHeight = height;
         advance();
         auto right = power();
-        left = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        left = makeNode<BinaryOpNode>(std::max(leftHeight, height), op, std::move(left), std::move(right));
     }
     return left;
 }
@@ -116,24 +235,28 @@ std::unique_ptr<Expr> Parser::power() {
     auto left = factor();
     if (currentToken().type == TokenType::POWER) {
         TokenType op = currentToken().type;
+        size_t leftHeight = height;
         advance();
+        DepthGuard guard(depth, limits.maxDepth);
         auto right = power();  // right recursion for right-associativity
-        left = std::make_unique<BinaryOpNode>(op, std::move(left), std::move(right));
+        left = makeNode<BinaryOpNode>(std::max(leftHeight, height), op, std::move(left), std::move(right));
     }
     return left;
 }
 
-// factor → NUMBER | IDENTIFIER | (expr) | unary_op factor
-// unary_op → + | - | ~
+// factor → NUMBER | IDENTIFIER | (conditional) | unary_op factor
+// unary_op → + | - | ~ | !
 std::unique_ptr<Expr> Parser::factor() {
+    DepthGuard guard(depth, limits.maxDepth);
     if (currentToken().type == TokenType::PLUS ||
         currentToken().type == TokenType::MINUS ||
-        currentToken().type == TokenType::BIT_NOT) {  // ~ operator
+        currentToken().type == TokenType::BIT_NOT ||      // ~ operator
+        currentToken().type == TokenType::LOGICAL_NOT) {  // ! operator
 
         TokenType op = currentToken().type;
         advance();
         auto operand = factor();
-        return std::make_unique<UnaryOpNode>(op, std::move(operand));
+        return makeNode<UnaryOpNode>(height, op, std::move(operand));
     }
 
     if (currentToken().type == TokenType::NUMBER) {
@@ -148,7 +271,7 @@ std::unique_ptr<Expr> Parser::factor() {
         }
 
         advance();
-        return std::make_unique<NumberNode>(value);
+        return makeNode<NumberNode>(0, value);
     }
 
     if (currentToken().type == TokenType::IDENTIFIER) {
@@ -157,12 +280,12 @@ std::unique_ptr<Expr> Parser::factor() {
         }
         std::string name = std::get<std::string>(currentToken().value);
         advance();
-        return std::make_unique<VariableNode>(name);
+        return makeNode<VariableNode>(0, name);
     }
 
     if (currentToken().type == TokenType::LPAREN) {
         advance();
-        auto node = expr();
+        auto node = conditional();
         if (currentToken().type != TokenType::RPAREN)
             throw std::runtime_error("Expected ')'");
         advance();
@@ -0,0 +1,68 @@
+#include "core/Sandbox.h"
+#include "core/Lexer.h"
+#include "core/Parser.h"
+#include <algorithm>
+#include <limits>
+
+// ---------------- SandboxError ----------------
+
+SandboxError::SandboxError(Kind kind, const std::string& message)
+    : std::runtime_error(message), errorKind(kind) {}
+
+// ---------------- EvalBudget ----------------
+
+// First step count over the limit. UINT64_MAX means no step limit; it must not
+// wrap to 0, which would check the limits (and read the clock) on every step.
+static uint64_t firstStepOver(uint64_t maxSteps) {
+    return maxSteps == std::numeric_limits<uint64_t>::max() ? maxSteps : maxSteps + 1;
+}
+
+EvalBudget::EvalBudget(uint64_t maxSteps, Clock::time_point deadline)
+    : maxSteps(maxSteps), deadline(deadline) {
+    nextCheck = std::min(CLOCK_CHECK_INTERVAL, firstStepOver(maxSteps));
+}
+
+void EvalBudget::checkLimits() {
+    if (steps > maxSteps) {
+        throw SandboxError(SandboxError::Kind::StepLimit,
+                           "Evaluation step limit exceeded (" + std::to_string(maxSteps) + ")");
+    }
+    if (deadline != Clock::time_point::max() && Clock::now() > deadline) {
+        throw SandboxError(SandboxError::Kind::Timeout, "Evaluation timed out");
+    }
+    nextCheck = std::min(steps + CLOCK_CHECK_INTERVAL, firstStepOver(maxSteps));
+}
+
+// ---------------- Sandbox ----------------
+
+Sandbox::Sandbox(const SandboxLimits& limits) : sandboxLimits(limits) {}
+
+EvalBudget Sandbox::makeBudget(EvalBudget::Clock::time_point start) const {
+    auto deadline = EvalBudget::Clock::time_point::max();
+    if (sandboxLimits.timeout.count() > 0) deadline = start + sandboxLimits.timeout;
+    return EvalBudget(sandboxLimits.maxSteps, deadline);
+}
+
+std::unique_ptr<Expr> Sandbox::compile(const std::string& source) const {
+    if (source.length() > sandboxLimits.maxInputLength) {
+        throw SandboxError(SandboxError::Kind::InputTooLong,
+                           "Input exceeds " + std::to_string(sandboxLimits.maxInputLength) + " characters");
+    }
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize(), ParseLimits{sandboxLimits.maxDepth, sandboxLimits.maxNodes});
+    return parser.parse();
+}
+
+double Sandbox::evaluate(const Expr& expr, VarContext& context) const {
+    // Only read the clock when a timeout is configured
+    auto start = sandboxLimits.timeout.count() > 0 ? EvalBudget::Clock::now() : EvalBudget::Clock::time_point();
+    EvalBudget budget = makeBudget(start);
+    return expr.evaluate(context, budget);
+}
+
+double Sandbox::evaluate(const std::string& source, VarContext& context) const {
+    auto start = sandboxLimits.timeout.count() > 0 ? EvalBudget::Clock::now() : EvalBudget::Clock::time_point();
+    std::unique_ptr<Expr> expr = compile(source);
+    EvalBudget budget = makeBudget(start);
+    return expr->evaluate(context, budget);
+}
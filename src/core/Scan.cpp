@@ -0,0 +1,181 @@
+#include "core/Scan.h"
+#include "core/CharClass.h"
+#include <stdexcept>
+#include <cstdint>
+#include <string>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MINIEXPR_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// ---------------- Scalar ----------------
+
+static size_t skipSpacesScalar(const char* data, size_t pos, size_t len) {
+    while (pos < len && isSpaceChar(data[pos])) ++pos;
+    return pos;
+}
+
+static size_t skipDigitsScalar(const char* data, size_t pos, size_t len) {
+    while (pos < len && isDigitChar(data[pos])) ++pos;
+    return pos;
+}
+
+static size_t skipIdentifierScalar(const char* data, size_t pos, size_t len) {
+    while (pos < len && isIdentChar(data[pos])) ++pos;
+    return pos;
+}
+
+#ifdef MINIEXPR_X86_SIMD
+
+// ---------------- SSE4.2 ----------------
+// PCMPESTRI with CMP_RANGES | NEGATIVE_POLARITY returns the index of the first
+// byte outside every [lo, hi] pair in the range operand, or 16 if there is none.
+// Full 16-byte blocks only; the tail is finished by the scalar loop.
+
+constexpr int SSE42_RANGE_MODE =
+    _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT;
+
+__attribute__((target("sse4.2")))
+static size_t skipRangesSSE42(const char* data, size_t pos, size_t len, __m128i ranges, int rangeLen) {
+    while (pos + 16 <= len) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        int idx = _mm_cmpestri(ranges, rangeLen, chunk, 16, SSE42_RANGE_MODE);
+        if (idx != 16) return pos + idx;
+        pos += 16;
+    }
+    return pos;
+}
+
+__attribute__((target("sse4.2")))
+static size_t skipSpacesSSE42(const char* data, size_t pos, size_t len) {
+    if (pos < len && !isSpaceChar(data[pos])) return pos;  // most runs are empty
+    const __m128i ranges = _mm_setr_epi8('\t', '\r', ' ', ' ', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    return skipSpacesScalar(data, skipRangesSSE42(data, pos, len, ranges, 4), len);
+}
+
+__attribute__((target("sse4.2")))
+static size_t skipDigitsSSE42(const char* data, size_t pos, size_t len) {
+    const __m128i ranges = _mm_setr_epi8('0', '9', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    return skipDigitsScalar(data, skipRangesSSE42(data, pos, len, ranges, 2), len);
+}
+
+__attribute__((target("sse4.2")))
+static size_t skipIdentifierSSE42(const char* data, size_t pos, size_t len) {
+    const __m128i ranges = _mm_setr_epi8('0', '9', 'A', 'Z', 'a', 'z', '_', '_', 0, 0, 0, 0, 0, 0, 0, 0);
+    return skipIdentifierScalar(data, skipRangesSSE42(data, pos, len, ranges, 8), len);
+}
+
+// ---------------- AVX2 ----------------
+// Classify 32 bytes with compares, then find the first non-matching byte from the movemask.
+
+__attribute__((target("avx2")))
+static inline __m256i inRangeAVX2(__m256i v, char lo, char span) {
+    // (unsigned)(v - lo) <= span
+    __m256i off = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(off, _mm256_set1_epi8(span)), off);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i spaceMaskAVX2(__m256i v) {
+    return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), inRangeAVX2(v, '\t', '\r' - '\t'));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i digitMaskAVX2(__m256i v) {
+    return inRangeAVX2(v, '0', 9);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i identMaskAVX2(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));  // folds A-Z onto a-z
+    __m256i alpha = inRangeAVX2(lower, 'a', 25);
+    __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return _mm256_or_si256(_mm256_or_si256(alpha, under), digitMaskAVX2(v));
+}
+
+#define MINIEXPR_AVX2_SCAN(MASK_FN)                                                        \
+    while (pos + 32 <= len) {                                                              \
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));      \
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(MASK_FN(v)));           \
+        if (mask != 0xFFFFFFFFu) return pos + __builtin_ctz(~mask);                        \
+        pos += 32;                                                                         \
+    }
+
+__attribute__((target("avx2")))
+static size_t skipSpacesAVX2(const char* data, size_t pos, size_t len) {
+    if (pos < len && !isSpaceChar(data[pos])) return pos;  // most runs are empty
+    MINIEXPR_AVX2_SCAN(spaceMaskAVX2)
+    return skipSpacesScalar(data, pos, len);
+}
+
+__attribute__((target("avx2")))
+static size_t skipDigitsAVX2(const char* data, size_t pos, size_t len) {
+    MINIEXPR_AVX2_SCAN(digitMaskAVX2)
+    return skipDigitsScalar(data, pos, len);
+}
+
+__attribute__((target("avx2")))
+static size_t skipIdentifierAVX2(const char* data, size_t pos, size_t len) {
+    MINIEXPR_AVX2_SCAN(identMaskAVX2)
+    return skipIdentifierScalar(data, pos, len);
+}
+
+#undef MINIEXPR_AVX2_SCAN
+
+#endif // MINIEXPR_X86_SIMD
+
+// ---------------- Dispatch ----------------
+
+static const Scanner SCALAR_SCANNER = { skipSpacesScalar, skipDigitsScalar, skipIdentifierScalar };
+#ifdef MINIEXPR_X86_SIMD
+static const Scanner SSE42_SCANNER = { skipSpacesSSE42, skipDigitsSSE42, skipIdentifierSSE42 };
+static const Scanner AVX2_SCANNER = { skipSpacesAVX2, skipDigitsAVX2, skipIdentifierAVX2 };
+#endif
+
+bool isScanBackendSupported(ScanBackend backend) {
+    switch (backend) {
+        case ScanBackend::Auto:
+        case ScanBackend::Scalar:
+            return true;
+#ifdef MINIEXPR_X86_SIMD
+        case ScanBackend::SSE42:
+            return __builtin_cpu_supports("sse4.2");
+        case ScanBackend::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+static ScanBackend resolveBackend(ScanBackend backend) {
+    if (backend != ScanBackend::Auto) return backend;
+    static const ScanBackend best =
+        isScanBackendSupported(ScanBackend::AVX2)  ? ScanBackend::AVX2 :
+        isScanBackendSupported(ScanBackend::SSE42) ? ScanBackend::SSE42 : ScanBackend::Scalar;
+    return best;
+}
+
+const Scanner& getScanner(ScanBackend backend) {
+    backend = resolveBackend(backend);
+    if (!isScanBackendSupported(backend)) {
+        throw std::runtime_error(std::string("Scan backend not supported: ") + scanBackendName(backend));
+    }
+    switch (backend) {
+#ifdef MINIEXPR_X86_SIMD
+        case ScanBackend::SSE42: return SSE42_SCANNER;
+        case ScanBackend::AVX2:  return AVX2_SCANNER;
+#endif
+        default:                 return SCALAR_SCANNER;
+    }
+}
+
+const char* scanBackendName(ScanBackend backend) {
+    switch (resolveBackend(backend)) {
+        case ScanBackend::Scalar: return "scalar";
+        case ScanBackend::SSE42:  return "sse4.2";
+        case ScanBackend::AVX2:   return "avx2";
+        default:                  return "?";
+    }
+}
@@ -0,0 +1,451 @@
+#include "core/Server.h"
+#include <cstring>
+#include <stdexcept>
+
+// ---------------- Frame encoding ----------------
+
+static void appendU32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out += static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+static uint32_t readU32(const char* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+
+static void appendDouble(std::string& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; ++i) out += static_cast<char>((bits >> (8 * i)) & 0xFF);
+}
+
+static double readDouble(const char* p) {
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; ++i) bits |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void appendRequest(std::string& out, ServerOp op, const std::string& body) {
+    appendU32(out, static_cast<uint32_t>(body.size() + 1));
+    out += static_cast<char>(op);
+    out += body;
+}
+
+void appendReply(std::string& out, const ServerReply& reply) {
+    if (reply.ok()) {
+        appendU32(out, 1 + 8);
+        out += static_cast<char>(ServerStatus::Ok);
+        appendDouble(out, reply.value);
+    } else {
+        appendU32(out, static_cast<uint32_t>(reply.error.size() + 1));
+        out += static_cast<char>(ServerStatus::Error);
+        out += reply.error;
+    }
+}
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Bytes read from one connection per event-loop round, so a flooding client
+// cannot starve the others
+constexpr size_t READ_BUDGET = 256 * 1024;
+
+// A connection whose unsent replies exceed this stops being read until they drain
+constexpr size_t MAX_BUFFERED_OUTPUT = 1024 * 1024;
+
+constexpr int MAX_EVENTS = 64;
+
+static std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+static sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Invalid socket path: " + path);
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+// ---------------- Server ----------------
+
+Server::Server(const ServerOptions& options)
+    : options(options), sandbox(options.limits), pool(options.threads) {}
+
+Server::~Server() {
+    for (auto& entry : connections) ::close(entry.first);
+    if (wakeFd >= 0) ::close(wakeFd);
+    if (epollFd >= 0) ::close(epollFd);
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        ::unlink(options.socketPath.c_str());
+    }
+}
+
+void Server::listen() {
+    if (listenFd >= 0) return;
+    sockaddr_un addr = socketAddress(options.socketPath);
+
+    // Replace a socket left behind by an earlier run, but never any other kind of file
+    struct stat st;
+    if (::stat(options.socketPath.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) throw std::runtime_error("Not a socket: " + options.socketPath);
+        ::unlink(options.socketPath.c_str());
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) throw systemError("socket");
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+        std::runtime_error error = systemError("bind " + options.socketPath);
+        ::close(fd);
+        throw error;
+    }
+    listenFd = fd;
+
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) throw systemError("epoll_create1");
+    wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) throw systemError("eventfd");
+
+    for (int watched : {listenFd, wakeFd}) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = watched;
+        if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, watched, &ev) < 0) throw systemError("epoll_ctl");
+    }
+}
+
+void Server::stop() {
+    stopping.store(true);
+    if (wakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void Server::run() {
+    listen();
+    epoll_event events[MAX_EVENTS];
+    std::vector<Connection*> ready;
+
+    while (!stopping.load()) {
+        int n = ::epoll_wait(epollFd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw systemError("epoll_wait");
+        }
+
+        // Read and decode everything that arrived; formulas are compiled here,
+        // on the loop thread, so the cache needs no locking
+        ready.clear();
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptConnections();
+                continue;
+            }
+            if (fd == wakeFd) {
+                uint64_t count;
+                ssize_t ignored = ::read(wakeFd, &count, sizeof(count));
+                (void)ignored;
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end()) continue;
+            Connection& conn = *it->second;
+
+            if (events[i].events & EPOLLOUT) flushOutput(conn);
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                bool open = readInput(conn);
+                decodeFrames(conn);  // requests sent before a half-close still get replies
+                if (!open) conn.closing = true;
+            }
+            if (!conn.pending.empty()) ready.push_back(&conn);
+        }
+
+        // One dispatch for the whole round: sessions are independent, so
+        // connections evaluate in parallel while each keeps its request order
+        if (ready.size() == 1) {
+            evaluatePending(*ready[0]);
+        } else if (!ready.empty()) {
+            pool.parallelFor(ready.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t k = begin; k < end; ++k) evaluatePending(*ready[k]);
+            });
+        }
+
+        for (Connection* conn : ready) flushOutput(*conn);
+
+        for (int i = 0; i < n; ++i) {
+            auto it = connections.find(events[i].data.fd);
+            if (it == connections.end()) continue;
+            Connection& conn = *it->second;
+            if (conn.closing && conn.output.empty()) {
+                closeConnection(conn.fd);
+            } else {
+                updateInterest(conn);
+            }
+        }
+    }
+}
+
+void Server::acceptConnections() {
+    while (true) {
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;  // EAGAIN, or a client that gave up before we got to it
+
+        auto conn = std::make_unique<Connection>();
+        conn->fd = fd;
+        conn->events = EPOLLIN;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            ::close(fd);
+            continue;
+        }
+        connections.emplace(fd, std::move(conn));
+    }
+}
+
+// Returns false once the peer has closed its end or the socket failed
+bool Server::readInput(Connection& conn) {
+    char buf[64 * 1024];
+    size_t total = 0;
+    while (total < READ_BUDGET) {
+        ssize_t got = ::recv(conn.fd, buf, sizeof(buf), 0);
+        if (got > 0) {
+            conn.input.append(buf, static_cast<size_t>(got));
+            total += static_cast<size_t>(got);
+        } else if (got == 0) {
+            return false;
+        } else {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+    }
+    return true;
+}
+
+void Server::decodeFrames(Connection& conn) {
+    size_t pos = 0;
+    while (!conn.closing && conn.input.size() - pos >= FRAME_HEADER_SIZE) {
+        uint32_t length = readU32(conn.input.data() + pos);
+        if (length == 0 || length > options.maxFrameSize) {
+            conn.closing = true;  // malformed stream: no way to resynchronize
+            break;
+        }
+        if (conn.input.size() - pos - FRAME_HEADER_SIZE < length) break;
+
+        const char* payload = conn.input.data() + pos + FRAME_HEADER_SIZE;
+        Request request{static_cast<ServerOp>(payload[0]), nullptr};
+        if (request.op == ServerOp::Eval) request.formula = compile(std::string(payload + 1, length - 1));
+        conn.pending.push_back(std::move(request));
+        pos += FRAME_HEADER_SIZE + length;
+    }
+    conn.input.erase(0, conn.closing ? conn.input.size() : pos);
+}
+
+std::shared_ptr<const Server::Compiled> Server::compile(const std::string& source) {
+    auto it = cache.find(source);
+    if (it != cache.end()) return it->second;
+
+    // Full cache: start over. Requests already decoded keep their formulas alive.
+    if (cache.size() >= options.cacheCapacity) cache.clear();
+
+    auto compiled = std::make_shared<Compiled>();
+    try {
+        compiled->ast = sandbox.compile(source);
+    } catch (const std::exception& ex) {
+        compiled->error = ex.what();
+    }
+    if (options.cacheCapacity > 0) cache.emplace(source, compiled);
+    return compiled;
+}
+
+// Runs on a pool thread; touches only this connection and immutable ASTs
+void Server::evaluatePending(Connection& conn) const {
+    for (const Request& request : conn.pending) {
+        ServerReply reply;
+        switch (request.op) {
+            case ServerOp::Eval:
+                if (!request.formula->ast) {
+                    reply.error = request.formula->error;
+                    break;
+                }
+                try {
+                    reply.value = sandbox.evaluate(*request.formula->ast, conn.session);
+                    reply.status = ServerStatus::Ok;
+                } catch (const std::exception& ex) {
+                    reply.error = ex.what();
+                }
+                break;
+            case ServerOp::Reset:
+                conn.session.clear();
+                reply.status = ServerStatus::Ok;
+                break;
+            default:
+                reply.error = "Unknown opcode " + std::to_string(static_cast<unsigned>(request.op));
+                break;
+        }
+        appendReply(conn.output, reply);
+    }
+    conn.pending.clear();
+}
+
+void Server::flushOutput(Connection& conn) {
+    size_t sent = 0;
+    while (sent < conn.output.size()) {
+        ssize_t n = ::send(conn.fd, conn.output.data() + sent, conn.output.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                conn.closing = true;  // peer is gone; drop what is left
+                sent = conn.output.size();
+            }
+            break;
+        }
+    }
+    conn.output.erase(0, sent);
+}
+
+// Watches for writability only while replies are queued, and stops reading
+// from clients that are not draining their replies
+void Server::updateInterest(Connection& conn) {
+    uint32_t wanted = 0;
+    if (!conn.closing && conn.output.size() < MAX_BUFFERED_OUTPUT) wanted |= EPOLLIN;
+    if (!conn.output.empty()) wanted |= EPOLLOUT;
+    if (wanted == conn.events) return;
+
+    epoll_event ev{};
+    ev.events = wanted;
+    ev.data.fd = conn.fd;
+    ::epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+    conn.events = wanted;
+}
+
+void Server::closeConnection(int fd) {
+    ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections.erase(fd);
+}
+
+// ---------------- ServerClient ----------------
+
+ServerClient::ServerClient(const std::string& socketPath) {
+    sockaddr_un addr = socketAddress(socketPath);
+    fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) throw systemError("socket");
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::runtime_error error = systemError("connect " + socketPath);
+        ::close(fd);
+        throw error;
+    }
+}
+
+ServerClient::~ServerClient() {
+    if (fd >= 0) ::close(fd);
+}
+
+ServerReply ServerClient::eval(const std::string& formula) {
+    send(ServerOp::Eval, formula);
+    return receive();
+}
+
+ServerReply ServerClient::reset() {
+    send(ServerOp::Reset, "");
+    return receive();
+}
+
+void ServerClient::send(ServerOp op, const std::string& body) {
+    std::string frame;
+    appendRequest(frame, op, body);
+    send(frame);
+}
+
+void ServerClient::send(const std::string& encoded) {
+    size_t sent = 0;
+    while (sent < encoded.size()) {
+        ssize_t n = ::send(fd, encoded.data() + sent, encoded.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw systemError("send");
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+ServerReply ServerClient::receive() {
+    auto fill = [&](size_t needed) {
+        while (buffer.size() - consumed < needed) {
+            char buf[64 * 1024];
+            ssize_t got = ::recv(fd, buf, sizeof(buf), 0);
+            if (got == 0) throw std::runtime_error("Server closed the connection");
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                throw systemError("recv");
+            }
+            buffer.append(buf, static_cast<size_t>(got));
+        }
+    };
+
+    fill(FRAME_HEADER_SIZE);
+    uint32_t length = readU32(buffer.data() + consumed);
+    if (length == 0) throw std::runtime_error("Malformed reply");
+    fill(FRAME_HEADER_SIZE + length);
+
+    const char* payload = buffer.data() + consumed + FRAME_HEADER_SIZE;
+    ServerReply reply;
+    reply.status = static_cast<ServerStatus>(payload[0]);
+    if (reply.ok()) {
+        if (length != 1 + 8) throw std::runtime_error("Malformed reply");
+        reply.value = readDouble(payload + 1);
+    } else {
+        reply.error.assign(payload + 1, length - 1);
+    }
+    consumed += FRAME_HEADER_SIZE + length;
+
+    // Drop consumed replies once they dominate the buffer
+    if (consumed > buffer.size() / 2) {
+        buffer.erase(0, consumed);
+        consumed = 0;
+    }
+    return reply;
+}
+
+#else  // !__linux__
+
+// Server mode relies on epoll; other platforms get a clear error instead
+
+Server::Server(const ServerOptions& options)
+    : options(options), sandbox(options.limits), pool(1) {}
+Server::~Server() = default;
+void Server::listen() { throw std::runtime_error("Server mode requires Linux (epoll)"); }
+void Server::run() { listen(); }
+void Server::stop() { stopping.store(true); }
+
+ServerClient::ServerClient(const std::string&) { throw std::runtime_error("Server mode requires Linux (epoll)"); }
+ServerClient::~ServerClient() = default;
+ServerReply ServerClient::eval(const std::string&) { return ServerReply(); }
+ServerReply ServerClient::reset() { return ServerReply(); }
+void ServerClient::send(ServerOp, const std::string&) {}
+void ServerClient::send(const std::string&) {}
+ServerReply ServerClient::receive() { return ServerReply(); }
+
+#endif
@@ -0,0 +1,81 @@
+#include "core/ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+// Claims chunks until the job is exhausted; called with the lock held
+void ThreadPool::runChunks(std::unique_lock<std::mutex>& lock) {
+    while (next < count) {
+        size_t begin = next;
+        size_t end = (count - begin > grain) ? begin + grain : count;
+        next = end;
+        ++busy;
+        lock.unlock();
+        try {
+            (*body)(begin, end);
+        } catch (...) {
+            lock.lock();
+            if (!error) error = std::current_exception();
+            next = count;  // abandon the remaining chunks
+            --busy;
+            continue;
+        }
+        lock.lock();
+        --busy;
+    }
+    if (busy == 0) done.notify_all();
+}
+
+void ThreadPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t seen = generation;
+    while (true) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) return;
+        seen = generation;
+        runChunks(lock);
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    if (count == 0) return;
+    if (grain == 0) grain = 1;
+
+    // Nothing to share: skip the handshake entirely
+    if (workers.empty() || count <= grain) {
+        body(0, count);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    this->body = &body;
+    this->count = count;
+    this->grain = grain;
+    this->next = 0;
+    this->error = nullptr;
+    ++generation;
+    wake.notify_all();
+
+    runChunks(lock);
+    done.wait(lock, [&] { return next >= this->count && busy == 0; });
+
+    this->body = nullptr;
+    std::exception_ptr err = error;
+    error = nullptr;
+    lock.unlock();
+    if (err) std::rethrow_exception(err);
+}
@@ -1,6 +1,6 @@
 #include "core/Token.h"
-#include <sstream>
-#include <iomanip>  // Added for std::setprecision
+#include "core/NumberFormat.h"
+#include <utility>
 
 Token::Token(TokenType t) : type(t), value(std::monostate{}) {}
 
@@ -10,18 +10,15 @@ Token::Token(TokenType t, double val) : type(t), value(val) {}
 
 Token::Token(TokenType t, const std::string& val) : type(t), value(val) {}
 
+Token::Token(TokenType t, std::string&& val) : type(t), value(std::move(val)) {}
+
 std::string Token::toString() const {
     switch (type) {
         case TokenType::NUMBER: {
             if (std::holds_alternative<int>(value)) {
                 return std::to_string(std::get<int>(value));
             } else if (std::holds_alternative<double>(value)) {
-                std::ostringstream oss;
-                oss << std::fixed << std::setprecision(6) << std::get<double>(value);
-                std::string s = oss.str();
-                s.erase(s.find_last_not_of('0') + 1, std::string::npos);
-                if (!s.empty() && s.back() == '.') s.pop_back();
-                return s;
+                return formatNumber(std::get<double>(value));
             }
             break;
         }
@@ -50,6 +47,19 @@ std::string Token::toString() const {
         case TokenType::LSHIFT:     return "<<";
         case TokenType::RSHIFT:     return ">>";
 
+        // Comparison, logical and conditional operators
+        case TokenType::LESS:           return "<";
+        case TokenType::LESS_EQUAL:     return "<=";
+        case TokenType::GREATER:        return ">";
+        case TokenType::GREATER_EQUAL:  return ">=";
+        case TokenType::EQUAL:          return "==";
+        case TokenType::NOT_EQUAL:      return "!=";
+        case TokenType::LOGICAL_AND:    return "&&";
+        case TokenType::LOGICAL_OR:     return "||";
+        case TokenType::LOGICAL_NOT:    return "!";
+        case TokenType::QUESTION:       return "?";
+        case TokenType::COLON:          return ":";
+
         case TokenType::END:        return "<END>";
     }
     return "<UNKNOWN>";
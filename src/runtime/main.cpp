@@ -6,9 +6,75 @@ static std::string trim(const std::string& s) {
     return (start == std::string::npos) ? "" : s.substr(start, end - start + 1);
 }
 
-int main() {
+// Appends "Result: <value>\n" using the shortest round-trip formatting
+static void appendResult(std::string& out, double result) {
+    char buf[NUMBER_BUFFER_SIZE];
+    out += "Result: ";
+    out.append(buf, formatNumber(result, buf, buf + sizeof(buf)));
+    out += '\n';
+}
+
+// File mode: statements are parsed (and independent ones evaluated) in parallel,
+// results are printed in source order
+static int runFile(const std::string& path, unsigned threads) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Error: cannot open " << path << "\n";
+        return 1;
+    }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    VarContext context;
+    Loader loader(threads);
+    std::vector<Statement> statements = loader.parse(text);
+    std::vector<StatementResult> results = loader.evaluate(statements, context);
+
+    std::string out;
+    int failures = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].ok) {
+            appendResult(out, results[i].value);
+        } else {
+            out += "Error (line " + std::to_string(statements[i].line) + "): " + results[i].error + "\n";
+            ++failures;
+        }
+    }
+    std::cout.write(out.data(), out.size());
+    return failures == 0 ? 0 : 1;
+}
+
+// Server mode: evaluates requests on a Unix domain socket until SIGINT/SIGTERM
+static Server* activeServer = nullptr;
+
+static void stopServer(int /*signal*/) {
+    if (activeServer) activeServer->stop();
+}
+
+static int runServer(const std::string& path, unsigned threads) {
+    ServerOptions options;
+    options.socketPath = path;
+    options.threads = threads;
+    try {
+        Server server(options);
+        server.listen();
+        activeServer = &server;
+        std::signal(SIGINT, stopServer);
+        std::signal(SIGTERM, stopServer);
+        std::cerr << "Listening on " << path << "\n";
+        server.run();
+        activeServer = nullptr;
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+static void runRepl() {
     std::cout << "Enter arithmetic expressions including +, -, *, /, %, **, &, |, ^, ~, <<, >>\n";
+    std::cout << "Comparisons (<, <=, >, >=, ==, !=), logic (&&, ||, !) and cond ? a : b are supported.\n";
     std::cout << "Supports variables and assignments (e.g., x = 5 * 3).\n";
+    std::cout << "Type :metrics (or :metrics json) for pipeline counters and latencies.\n";
     std::cout << "Press Enter on empty line to quit.\n";
 
     std::string input;
@@ -21,6 +87,14 @@ int main() {
 
         if (input.empty()) break;
 
+        // :metrics prints Prometheus text, :metrics json the JSON form
+        if (input == ":metrics" || input == ":metrics json") {
+            MetricsSnapshot snapshot = Metrics::snapshot();
+            std::string text = input == ":metrics" ? Metrics::toPrometheus(snapshot) : Metrics::toJson(snapshot) + "\n";
+            std::cout.write(text.data(), text.size());
+            continue;
+        }
+
         try {
             Lexer lexer(input);
             std::vector<Token> tokens = lexer.tokenize();
@@ -32,17 +106,63 @@ int main() {
 
             double result = ast->evaluate(context);
 
-            std::cout << "Result: ";
-            constexpr double EPS = 1e-9;
-            if (std::abs(result - static_cast<int>(result)) < EPS) {
-                std::cout << static_cast<int>(result) << "\n";
-            } else {
-                std::cout << std::fixed << std::setprecision(6) << result << "\n";
-            }
+            std::string line;
+            appendResult(line, result);
+            std::cout.write(line.data(), line.size());
         } catch (const std::exception& ex) {
             std::cerr << "Error: " << ex.what() << "\n";
         }
     }
+}
 
-    return 0;
+int main(int argc, char** argv) {
+    std::ios::sync_with_stdio(false);  // std::cin stays tied to std::cout, so prompts still flush
+
+    unsigned threads = 0;
+    std::string file;
+    std::string socketPath;
+    std::string tracePath;
+    auto usage = [&] {
+        std::cerr << "Usage: " << argv[0] << " [--threads N] [--trace FILE] [--serve SOCKET | file]\n";
+        return 2;
+    };
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            // The whole argument must be a number that fits
+            std::string value = argv[++i];
+            auto res = std::from_chars(value.data(), value.data() + value.size(), threads);
+            if (res.ec != std::errc() || res.ptr != value.data() + value.size()) return usage();
+        } else if (arg == "--serve" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (!arg.empty() && arg[0] == '-') {
+            return usage();
+        } else {
+            file = arg;
+        }
+    }
+
+    Metrics::setEnabled(true);
+    if (!tracePath.empty()) Metrics::startTrace();
+
+    int status = 0;
+    if (!socketPath.empty()) {
+        status = runServer(socketPath, threads);
+    } else if (!file.empty()) {
+        status = runFile(file, threads);
+    } else {
+        runRepl();
+    }
+
+    // Chrome trace-event JSON: open in chrome://tracing or ui.perfetto.dev
+    if (!tracePath.empty()) {
+        Metrics::stopTrace();
+        if (!Metrics::writeTrace(tracePath)) {
+            std::cerr << "Error: cannot write trace to " << tracePath << "\n";
+            status = 1;
+        }
+    }
+    return status;
 }
@@ -1,10 +1,23 @@
 #include "core/Lexer.h"
 #include "core/Parser.h"
 #include "core/AST.h"
+#include "core/NumberFormat.h"
+#include "core/Loader.h"
+#include "core/Sandbox.h"
+#include "core/Server.h"
+#include "core/Aggregate.h"
+#include "core/Metrics.h"
 #include <iostream>
 #include <cassert>
+#include <cctype>
+#include <charconv>
 #include <cmath>
 #include <limits>
+#include <random>
+#include <cstring>
+#include <cstdint>
+#include <thread>
+#include <unistd.h>
 
 // Helper to run one expression and check result (approximate for floating point)
 void testExpression(const std::string& input, double expected, VarContext& context) {
@@ -101,6 +114,841 @@ void testBitwiseOperations() {
     std::cout << "Bitwise operation tests PASSED.\n";
 }
 
+// Number literal lexing and shortest round-trip formatting
+void testNumberFormatting() {
+    VarContext context;
+
+    // Scientific and hexadecimal literals
+    testExpression("1e-9", 1e-9, context);
+    testExpression("2.5e3 + 1E2", 2600, context);
+    testExpression("3e+2", 300, context);
+    testExpression("0x1F", 31, context);
+    testExpression("0XfF & 0x0f", 15, context);
+    testExpression("4294967296 / 2", 2147483648.0, context);  // too large for int, kept as double
+
+    assert(formatNumber(0.1) == "0.1");
+    assert(formatNumber(1e-9) == "1e-09");
+    assert(formatNumber(1000000) == "1000000");
+    assert(formatNumber(-0.0) == "-0");
+    assert(formatNumber(0.1 + 0.2) == "0.30000000000000004");
+
+    // AST printing must round-trip through the lexer
+    {
+        Lexer lexer("x = 0.1 + 2.5e-7");
+        Parser parser(lexer.tokenize());
+        assert(parser.parse()->toString() == "x = (0.1 + 2.5e-07)");
+    }
+
+    // Random bit patterns: format -> parse must reproduce the exact double
+    std::mt19937_64 rng(12345);
+    for (int i = 0; i < 200000; ++i) {
+        uint64_t bits = rng();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        if (!std::isfinite(value)) continue;
+
+        char buf[NUMBER_BUFFER_SIZE];
+        char* end = formatNumber(value, buf, buf + sizeof(buf));
+        double parsed = 0.0;
+        bool ok = parseNumber(buf, end, parsed);
+        if (!ok || std::memcmp(&parsed, &value, sizeof(value)) != 0) {
+            std::cerr << "Round-trip FAILED for " << std::string(buf, end) << "\n";
+            assert(false);
+        }
+
+        // Positive values also survive a trip through the lexer
+        if (value > 0) {
+            Lexer lexer(std::string(buf, end));
+            Parser parser(lexer.tokenize());
+            double lexed = parser.parse()->evaluate(context);
+            assert(std::memcmp(&lexed, &value, sizeof(value)) == 0);
+        }
+    }
+
+    std::cout << "Number formatting tests PASSED.\n";
+}
+
+static std::string summarize(const std::vector<Token>& tokens) {
+    std::string out;
+    for (const auto& tok : tokens) out += std::to_string(static_cast<int>(tok.type)) + ":" + tok.toString() + " ";
+    return out;
+}
+
+// Lex with one scan backend, flattening the result (or the error) to a comparable string
+static std::string lexSummary(const std::string& input, ScanBackend backend) {
+    try {
+        Lexer lexer(input, backend);
+        return summarize(lexer.tokenize());
+    } catch (const std::exception& ex) {
+        return std::string("error: ") + ex.what();
+    }
+}
+
+// Reference for the lexer backends: the original character-at-a-time lexer,
+// using <cctype> instead of CharClass.h and plain loops instead of the run
+// scanners, with the comparison, logical and conditional operators added since
+class ReferenceLexer {
+public:
+    explicit ReferenceLexer(const std::string& input) : input(input) {}
+
+    std::vector<Token> tokenize() {
+        std::vector<Token> tokens;
+        while (true) {
+            while (std::isspace(static_cast<unsigned char>(currentChar()))) ++pos;
+            char ch = currentChar();
+            if (ch == '\0') {
+                tokens.emplace_back(TokenType::END);
+                return tokens;
+            }
+            if (std::isalpha(static_cast<unsigned char>(ch)) || ch == '_') {
+                size_t start = pos;
+                while (std::isalnum(static_cast<unsigned char>(currentChar())) || currentChar() == '_') ++pos;
+                tokens.emplace_back(TokenType::IDENTIFIER, input.substr(start, pos - start));
+            } else if (std::isdigit(static_cast<unsigned char>(ch))) {
+                tokens.push_back(number());
+            } else {
+                tokens.push_back(symbol(ch));
+            }
+        }
+    }
+
+private:
+    std::string input;
+    size_t pos = 0;
+
+    char currentChar() const { return pos < input.length() ? input[pos] : '\0'; }
+    char peekChar() const { return pos + 1 < input.length() ? input[pos + 1] : '\0'; }
+
+    Token number() {
+        size_t start = pos;
+        if (currentChar() == '0' && (peekChar() == 'x' || peekChar() == 'X') && pos + 2 < input.length() &&
+            std::isxdigit(static_cast<unsigned char>(input[pos + 2]))) {
+            pos += 2;
+            size_t digits = pos;
+            while (std::isxdigit(static_cast<unsigned char>(currentChar()))) ++pos;
+            unsigned long long val = 0;
+            if (std::from_chars(input.data() + digits, input.data() + pos, val, 16).ec != std::errc()) {
+                throw std::runtime_error("Number out of range: " + input.substr(start, pos - start));
+            }
+            if (val <= static_cast<unsigned long long>(std::numeric_limits<int>::max())) {
+                return Token(TokenType::NUMBER, static_cast<int>(val));
+            }
+            return Token(TokenType::NUMBER, static_cast<double>(val));
+        }
+
+        bool hasDecimalPoint = false;
+        bool hasExponent = false;
+        while (true) {
+            char ch = currentChar();
+            if (std::isdigit(static_cast<unsigned char>(ch))) {
+                ++pos;
+            } else if (ch == '.' && !hasDecimalPoint) {
+                hasDecimalPoint = true;
+                ++pos;
+            } else {
+                break;
+            }
+        }
+        if (currentChar() == 'e' || currentChar() == 'E') {
+            size_t expPos = pos + 1;
+            if (expPos < input.length() && (input[expPos] == '+' || input[expPos] == '-')) expPos++;
+            if (expPos < input.length() && std::isdigit(static_cast<unsigned char>(input[expPos]))) {
+                hasExponent = true;
+                pos = expPos;
+                while (std::isdigit(static_cast<unsigned char>(currentChar()))) ++pos;
+            }
+        }
+
+        const char* first = input.data() + start;
+        const char* last = input.data() + pos;
+        if (!hasDecimalPoint && !hasExponent) {
+            int val = 0;
+            if (std::from_chars(first, last, val).ec == std::errc()) return Token(TokenType::NUMBER, val);
+        }
+        double val = 0.0;
+        if (!parseNumber(first, last, val)) {
+            throw std::runtime_error("Number out of range: " + input.substr(start, pos - start));
+        }
+        return Token(TokenType::NUMBER, val);
+    }
+
+    // One- or two-character operator starting at ch
+    Token symbol(char ch) {
+        char next = peekChar();
+        auto pair = [&](char second, TokenType both, TokenType single) {
+            pos += next == second ? 2 : 1;
+            return Token(next == second ? both : single);
+        };
+        switch (ch) {
+            case '+': ++pos; return Token(TokenType::PLUS);
+            case '-': ++pos; return Token(TokenType::MINUS);
+            case '/': ++pos; return Token(TokenType::DIV);
+            case '%': ++pos; return Token(TokenType::MOD);
+            case '(': ++pos; return Token(TokenType::LPAREN);
+            case ')': ++pos; return Token(TokenType::RPAREN);
+            case ',': ++pos; return Token(TokenType::COMMA);
+            case '^': ++pos; return Token(TokenType::BIT_XOR);
+            case '~': ++pos; return Token(TokenType::BIT_NOT);
+            case '?': ++pos; return Token(TokenType::QUESTION);
+            case ':': ++pos; return Token(TokenType::COLON);
+            case '*': return pair('*', TokenType::POWER, TokenType::MUL);
+            case '&': return pair('&', TokenType::LOGICAL_AND, TokenType::BIT_AND);
+            case '|': return pair('|', TokenType::LOGICAL_OR, TokenType::BIT_OR);
+            case '=': return pair('=', TokenType::EQUAL, TokenType::ASSIGN);
+            case '!': return pair('=', TokenType::NOT_EQUAL, TokenType::LOGICAL_NOT);
+            case '<':
+                if (next == '<') return pair('<', TokenType::LSHIFT, TokenType::LESS);
+                return pair('=', TokenType::LESS_EQUAL, TokenType::LESS);
+            case '>':
+                if (next == '>') return pair('>', TokenType::RSHIFT, TokenType::GREATER);
+                return pair('=', TokenType::GREATER_EQUAL, TokenType::GREATER);
+        }
+        throw std::runtime_error(std::string("Invalid character: ") + ch);
+    }
+};
+
+static std::string referenceLexSummary(const std::string& input) {
+    try {
+        return summarize(ReferenceLexer(input).tokenize());
+    } catch (const std::exception& ex) {
+        return std::string("error: ") + ex.what();
+    }
+}
+
+// Fuzz: every scan backend, scalar included, must produce the reference lexer's token stream
+void testLexerBackends() {
+    const std::string pieces[] = {
+        " ", "\t", "\n", "\r\n", "\v", "\f", "                                        ",
+        "0", "7", "12345678901234567890123456789012345", "3.25", "1e-9", "2E+3", "0x1F", "0x", ".",
+        "x", "_tmp", "abcdefghijklmnopqrstuvwxyzABCDEFGHIJ_0123456789", "Z9", "e",
+        "+", "-", "*", "**", "/", "%", "(", ")", ",", "=", "&", "|", "^", "~", "<<", ">>", "<", ">",
+        "!", "?", ":", "==", "<=", "&&",
+        "@", "$", "\x80", "\xff", std::string(1, '\0'), "`", "{", "[",
+    };
+    constexpr size_t PIECE_COUNT = sizeof(pieces) / sizeof(pieces[0]);
+
+    std::vector<ScanBackend> backends{ScanBackend::Scalar};
+    for (ScanBackend b : {ScanBackend::SSE42, ScanBackend::AVX2}) {
+        if (isScanBackendSupported(b)) backends.push_back(b);
+    }
+
+    std::mt19937 rng(2024);
+    for (int i = 0; i < 20000; ++i) {
+        std::string input;
+        size_t count = rng() % 24;
+        for (size_t j = 0; j < count; ++j) input += pieces[rng() % PIECE_COUNT];
+
+        std::string expected = referenceLexSummary(input);
+        for (ScanBackend b : backends) {
+            if (lexSummary(input, b) != expected) {
+                std::cerr << "Lexer backend " << scanBackendName(b) << " diverged from the reference lexer on: \""
+                          << input << "\"\n";
+                assert(false);
+            }
+        }
+    }
+
+    // Run scanners directly at every offset of a buffer mixing long runs, against <cctype>
+    std::string buf = "   \t\t\v\f 1234567890123456789012345678901234567890abc_DEF_ghi_jkl_mno_pqr_stu_vwx_yz09 \x80\xff_z  ";
+    auto run = [&](size_t p, auto inRun) {
+        while (p < buf.size() && inRun(static_cast<unsigned char>(buf[p]))) ++p;
+        return p;
+    };
+    for (ScanBackend b : backends) {
+        const Scanner& scanner = getScanner(b);
+        for (size_t p = 0; p <= buf.size(); ++p) {
+            assert(scanner.skipSpaces(buf.data(), p, buf.size()) == run(p, [](int c) { return std::isspace(c); }));
+            assert(scanner.skipDigits(buf.data(), p, buf.size()) == run(p, [](int c) { return std::isdigit(c); }));
+            assert(scanner.skipIdentifier(buf.data(), p, buf.size()) ==
+                   run(p, [](int c) { return std::isalnum(c) || c == '_'; }));
+        }
+    }
+
+    std::cout << "Lexer backend tests PASSED (" << backends.size() - 1 << " SIMD backends).\n";
+}
+
+// Parallel loader must match evaluating every line serially, in order
+void testLoader() {
+    std::mt19937 rng(99);
+    std::string text = "base = 3\n\n";
+    // Lands in the parallel wave of the w statements and must still see `self` undefined
+    text += "self = self + base\n";
+
+    // A wide block of independent assignments exercises the parallel waves
+    for (int i = 0; i < 6000; ++i) {
+        text += "w" + std::to_string(i) + " = base * " + std::to_string(i) + " - " + std::to_string(i % 7) + "\n";
+    }
+    // Followed by a tangle of dependent statements, errors and redefinitions
+    for (int i = 0; i < 6000; ++i) {
+        std::string a = "v" + std::to_string(rng() % 40);
+        std::string b = "v" + std::to_string(rng() % 40);
+        std::string w = "w" + std::to_string(rng() % 6000);
+        switch (rng() % 6) {
+            case 0: text += a + " = " + b + " + 1\n"; break;
+            case 1: text += a + " = " + w + " / (" + b + " % 3)\n"; break;
+            case 2: text += a + " = " + b + " = " + w + " & 255\n"; break;
+            case 3: text += b + " * 2\n"; break;
+            case 4: text += a + " = " + std::to_string(rng() % 10) + "\n"; break;
+            default: text += a + " = (" + b + "\n"; break;  // parse error
+        }
+    }
+
+    // Reference: one statement at a time
+    VarContext serialContext;
+    std::vector<StatementResult> expected;
+    {
+        Loader serial(1);
+        for (const auto& st : serial.parse(text)) {
+            StatementResult r;
+            try {
+                Lexer lexer(st.source);
+                Parser parser(lexer.tokenize());
+                r.value = parser.parse()->evaluate(serialContext);
+                r.ok = true;
+            } catch (const std::exception& ex) {
+                r.error = ex.what();
+            }
+            expected.push_back(r);
+        }
+    }
+
+    for (unsigned threads : {1u, 2u, 4u}) {
+        VarContext context;
+        Loader loader(threads);
+        auto results = loader.run(text, context);
+        assert(results.size() == expected.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            assert(results[i].ok == expected[i].ok);
+            assert(results[i].error == expected[i].error);
+            if (results[i].ok) assert(results[i].value == expected[i].value);
+        }
+        assert(context == serialContext);
+    }
+
+    std::cout << "Loader tests PASSED.\n";
+}
+
+// Expect a SandboxError of the given kind from evaluating input under limits
+static void expectSandboxError(const Sandbox& sandbox, const std::string& input, SandboxError::Kind kind) {
+    VarContext context;
+    try {
+        sandbox.evaluate(input, context);
+    } catch (const SandboxError& ex) {
+        if (ex.kind() != kind) {
+            std::cerr << "Sandbox test FAILED: wrong limit: " << ex.what() << "\n";
+            assert(false);
+        }
+        return;
+    } catch (const std::exception& ex) {
+        std::cerr << "Sandbox test FAILED: wrong error type: " << ex.what() << "\n";
+        assert(false);
+    }
+    std::cerr << "Sandbox test FAILED (no error) for input of length " << input.size() << "\n";
+    assert(false);
+}
+
+// Budgets for untrusted formulas
+void testSandbox() {
+    Sandbox sandbox;
+
+    // Ordinary formulas behave exactly like Expr::evaluate, including ordinary errors
+    VarContext context;
+    assert(sandbox.evaluate("x = 2 ** 10", context) == 1024);
+    assert(sandbox.evaluate("x >> 3", context) == 128);
+    try {
+        sandbox.evaluate("1 / 0", context);
+        assert(false);
+    } catch (const SandboxError&) {
+        assert(false);
+    } catch (const std::runtime_error& ex) {
+        assert(std::string(ex.what()) == "Division by zero");
+    }
+
+    // Pathological nesting is rejected by the parser instead of exhausting the stack
+    const size_t deep = 200000;
+    expectSandboxError(Sandbox(SandboxLimits{deep * 2 + 10}), std::string(deep, '(') + "1" + std::string(deep, ')'),
+                       SandboxError::Kind::DepthLimit);
+    expectSandboxError(Sandbox(SandboxLimits{deep * 2 + 10}), std::string(deep, '-') + "1", SandboxError::Kind::DepthLimit);
+    std::string powerChain = "2";
+    for (int i = 0; i < 1000; ++i) powerChain += " ** 2";
+    expectSandboxError(sandbox, powerChain, SandboxError::Kind::DepthLimit);
+
+    // Flat left-associative chains count toward the depth limit too: their AST is
+    // as tall as the chain is long, however few parentheses they use
+    std::string sum = "1";
+    for (int i = 0; i < 20000; ++i) sum += "+1";
+    SandboxLimits manyNodes;
+    manyNodes.maxInputLength = 1 << 20;
+    manyNodes.maxNodes = 200000;
+    expectSandboxError(Sandbox(manyNodes), sum, SandboxError::Kind::DepthLimit);
+    std::string flat = "x";
+    for (int i = 0; i < 100000; ++i) flat += i % 3 ? "+x" : "*x";
+    expectSandboxError(Sandbox(manyNodes), flat, SandboxError::Kind::DepthLimit);
+    manyNodes.maxDepth = 300;
+    assert(Sandbox(manyNodes).evaluate(std::string(sum, 0, 2 * 299 + 1), context) == 300);
+
+    SandboxLimits tall;
+    tall.maxDepth = 100000;
+    expectSandboxError(Sandbox(tall), sum, SandboxError::Kind::NodeLimit);
+    expectSandboxError(sandbox, std::string(100000, ' ') + "1", SandboxError::Kind::InputTooLong);
+
+    // Depth exactly at the limit is accepted
+    SandboxLimits tight;
+    tight.maxDepth = 4;
+    assert(Sandbox(tight).evaluate("((1))", context) == 1);
+    expectSandboxError(Sandbox(tight), "((((1))))", SandboxError::Kind::DepthLimit);
+
+    // Step and wall-clock budgets apply during evaluation
+    SandboxLimits fewSteps;
+    fewSteps.maxSteps = 100;
+    fewSteps.maxDepth = 10000;
+    assert(Sandbox(fewSteps).evaluate("1 + 2 * 3", context) == 7);
+    std::string wide = "1";
+    for (int i = 0; i < 200; ++i) wide += "+1";
+    expectSandboxError(Sandbox(fewSteps), wide, SandboxError::Kind::StepLimit);
+
+    SandboxLimits instant;
+    instant.timeout = std::chrono::nanoseconds(1);
+    instant.maxDepth = 10000;
+    std::string longSum = "1";
+    for (int i = 0; i < 4000; ++i) longSum += "+1";
+    expectSandboxError(Sandbox(instant), longSum, SandboxError::Kind::Timeout);
+
+    // No step limit (UINT64_MAX) still reads the clock only every CLOCK_CHECK_INTERVAL steps
+    for (uint64_t maxSteps : {uint64_t(1000000), std::numeric_limits<uint64_t>::max()}) {
+        EvalBudget expired(maxSteps, EvalBudget::Clock::now() - std::chrono::seconds(1));
+        for (uint64_t i = 1; i < EvalBudget::CLOCK_CHECK_INTERVAL; ++i) expired.step();
+        bool timedOut = false;
+        try {
+            expired.step();
+        } catch (const SandboxError& ex) {
+            timedOut = ex.kind() == SandboxError::Kind::Timeout;
+        }
+        assert(timedOut);
+    }
+
+    // The first error wins: nodes evaluated after it are not charged to the budget
+    for (const Sandbox& limited : {Sandbox(fewSteps), Sandbox(instant)}) {
+        bool divided = false;
+        try {
+            VarContext scratch;
+            limited.evaluate("1 / 0 + (" + longSum + ")", scratch);
+        } catch (const SandboxError&) {
+            assert(false);
+        } catch (const std::runtime_error& ex) {
+            divided = std::string(ex.what()) == "Division by zero";
+        }
+        assert(divided);
+    }
+
+    // Giant shift counts are well defined (count taken mod 32)
+    assert(sandbox.evaluate("1 << 33", context) == 2);
+    assert(sandbox.evaluate("1 << 1e300", context) == 1);
+
+    std::cout << "Sandbox tests PASSED.\n";
+}
+
+// Parse helper for tests that need the AST itself
+static std::unique_ptr<Expr> parseExpr(const std::string& input) {
+    Lexer lexer(input);
+    Parser parser(lexer.tokenize());
+    return parser.parse();
+}
+
+// Non-throwing evaluation path and numeric policies
+void testErrorCodes() {
+    VarContext context{{"x", 4}};
+
+    EvalResult r = parseExpr("x * 2 + 1")->tryEvaluate(context);
+    assert(r.ok() && r.value == 9);
+
+    r = parseExpr("10 / (x - 4)")->tryEvaluate(context);
+    assert(r.error == EvalError::DivisionByZero && r.message() == "Division by zero");
+    r = parseExpr("10 % 0")->tryEvaluate(context);
+    assert(r.error == EvalError::ModuloByZero && r.message() == "Modulo by zero");
+
+    auto undefined = parseExpr("x + missing");
+    r = undefined->tryEvaluate(context);
+    assert(r.error == EvalError::UndefinedVariable && r.message() == "Undefined variable: missing");
+
+    // The first error in evaluation order wins, as with the throwing API
+    r = parseExpr("nope / 0")->tryEvaluate(context);
+    assert(r.error == EvalError::UndefinedVariable);
+    r = parseExpr("(1 / 0) + nope")->tryEvaluate(context);
+    assert(r.error == EvalError::DivisionByZero);
+
+    // A failed assignment stores nothing, in any link of the chain
+    r = parseExpr("a = b = 1 / 0")->tryEvaluate(context);
+    assert(!r.ok() && context.count("a") == 0 && context.count("b") == 0);
+    r = parseExpr("x = 1 % 0")->tryEvaluate(context);
+    assert(!r.ok() && context["x"] == 4);
+
+    // IEEE policy: division and modulo by zero produce inf/NaN instead of errors
+    r = parseExpr("1 / 0")->tryEvaluate(context, NumericPolicy::IEEE);
+    assert(r.ok() && std::isinf(r.value) && r.value > 0);
+    r = parseExpr("-1 / (x - 4)")->tryEvaluate(context, NumericPolicy::IEEE);
+    assert(r.ok() && std::isinf(r.value) && r.value < 0);
+    r = parseExpr("y = 5 % 0")->tryEvaluate(context, NumericPolicy::IEEE);
+    assert(r.ok() && std::isnan(r.value) && std::isnan(context["y"]));
+    r = parseExpr("missing / 0")->tryEvaluate(context, NumericPolicy::IEEE);
+    assert(r.error == EvalError::UndefinedVariable);
+
+    // The throwing API reports the same messages
+    try {
+        undefined->evaluate(context);
+        assert(false);
+    } catch (const std::runtime_error& ex) {
+        assert(std::string(ex.what()) == "Undefined variable: missing");
+    }
+
+    std::cout << "Error code tests PASSED.\n";
+}
+
+// Comparison, logical and conditional operators, scalar and batch
+void testConditionals() {
+    VarContext context{{"x", 5}};
+
+    testExpression("1 < 2", 1, context);
+    testExpression("2 <= 1", 0, context);
+    testExpression("3 >= 3", 1, context);
+    testExpression("3 > 4", 0, context);
+    testExpression("3 == 3", 1, context);
+    testExpression("3 != 3", 0, context);
+    testExpression("!0 + !7", 1, context);
+    testExpression("1 && 0", 0, context);
+    testExpression("0 || 2", 1, context);
+    testExpression("1 << 2 < 5", 1, context);                // shifts bind tighter than comparisons
+    testExpression("1 + 2 < 4 && (5 & 4) == 4", 1, context); // comparisons bind tighter than &&
+    testExpression("0 && 1 || 1", 1, context);               // && binds tighter than ||
+    testExpression("x > 3 ? 10 : 20", 10, context);
+    testExpression("x > 7 ? 1 : x > 4 ? 2 : 3", 2, context); // right-associative
+    testExpression("(x < 0 ? -x : x) * 2", 10, context);
+    testExpression("y = x != 5 ? 0 : x ** 2", 25, context);
+
+    // Short-circuit: the skipped operand's errors never happen
+    testExpression("0 && 1 / 0", 0, context);
+    testExpression("1 || missing", 1, context);
+    testExpression("x > 0 ? x : 1 / 0", 5, context);
+    testError("1 && 1 / 0");
+    testError("x < 0 ? x : missing");
+
+    // Printed ASTs parse back to the same tree
+    auto ast = parseExpr("!b || c <= 2 ? d : e == f ? 1 : 2");
+    assert(ast->toString() == "(((!b) || (c <= 2)) ? d : ((e == f) ? 1 : 2))");
+    assert(parseExpr(ast->toString())->toString() == ast->toString());
+
+    // Batch evaluation must agree row by row with scalar tryEvaluate
+    const char* formulas[] = {
+        "x > y ? x * 2 - y : y / x",
+        "(x < 0.5 && y / x > 1) || x == y",
+        "!(x % y) ? (x & 7) << 2 : ~y",
+        "x >= 0.25 ? (y <= 0.5 ? x / (y - 0.5) : missing) : y % x",
+        "z = x != y && (x > y || y - x < 0.1)",
+    };
+    std::mt19937 rng(31);
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    const size_t rows = 1000;
+    std::vector<double> xs(rows), ys(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        xs[i] = (rng() % 5 == 0) ? 0.0 : uni(rng);
+        ys[i] = (rng() % 7 == 0) ? xs[i] : (rng() % 9 == 0 ? 0.5 : uni(rng) * 8);
+    }
+    BatchColumns columns{{"x", xs.data()}, {"y", ys.data()}};
+
+    for (const char* formula : formulas) {
+        auto expr = parseExpr(formula);
+        for (NumericPolicy policy : {NumericPolicy::Strict, NumericPolicy::IEEE}) {
+            std::vector<double> out(rows);
+            std::vector<EvalError> errors(rows);
+            expr->evaluateBatch(columns, rows, out.data(), errors.data(), policy);
+            for (size_t i = 0; i < rows; ++i) {
+                VarContext row{{"x", xs[i]}, {"y", ys[i]}};
+                EvalResult r = expr->tryEvaluate(row, policy);
+                bool same = r.error == errors[i] &&
+                            (!r.ok() || std::memcmp(&r.value, &out[i], sizeof(double)) == 0);
+                if (!same) {
+                    std::cerr << "Batch FAILED for " << formula << " at row " << i << "\n";
+                    assert(false);
+                }
+            }
+        }
+    }
+
+    // Deep left-leaning chains: batch scratch is on the heap, so the stack only
+    // holds a small frame per level, as in the tree walker
+    std::string chain = "x";
+    for (int i = 1; i < 5000; ++i) chain += i % 2 ? " + x" : " - y";
+    auto deep = parseExpr(chain);
+    std::vector<double> out(rows);
+    std::vector<EvalError> errors(rows);
+    deep->evaluateBatch(columns, rows, out.data(), errors.data());
+    for (size_t i = 0; i < rows; i += 97) {
+        VarContext row{{"x", xs[i]}, {"y", ys[i]}};
+        assert(errors[i] == EvalError::None && out[i] == deep->tryEvaluate(row).value);
+    }
+    ThreadPool pool(2);
+    assert(aggregate(*deep, columns, rows, NumericPolicy::Strict, &pool).count == rows);
+
+    std::cout << "Conditional operator tests PASSED.\n";
+}
+
+void testAggregate() {
+    const size_t rows = 3 * AGGREGATE_BLOCK + 777;  // partial last block and chunk
+    std::mt19937 rng(47);
+    std::uniform_real_distribution<double> uni(-1.0, 1.0);
+    std::vector<double> xs(rows), ys(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        xs[i] = uni(rng) * 1e6;
+        ys[i] = (rng() % 13 == 0) ? 0.0 : uni(rng);
+    }
+    BatchColumns columns{{"x", xs.data()}, {"y", ys.data()}};
+
+    for (const char* formula : {"x / y", "x > 0 ? x * y : x % y", "y == 0 ? 0 / y : x"}) {
+        auto expr = parseExpr(formula);
+        for (NumericPolicy policy : {NumericPolicy::Strict, NumericPolicy::IEEE}) {
+            // Reference: scalar evaluation, exact-ish sum in long double
+            long double refSum = 0;
+            double refMin = std::numeric_limits<double>::infinity();
+            double refMax = -refMin;
+            size_t refErrors = 0;
+            for (size_t i = 0; i < rows; ++i) {
+                VarContext row{{"x", xs[i]}, {"y", ys[i]}};
+                EvalResult r = expr->tryEvaluate(row, policy);
+                if (!r.ok()) {
+                    ++refErrors;
+                    continue;
+                }
+                refSum += r.value;
+                if (!std::isnan(r.value)) {
+                    refMin = std::min(refMin, r.value);
+                    refMax = std::max(refMax, r.value);
+                }
+            }
+
+            AggregateResult serial = aggregate(*expr, columns, rows, policy);
+            assert(serial.errors == refErrors && serial.count == rows - refErrors);
+            assert(serial.min == refMin && serial.max == refMax);
+            if (std::isfinite(static_cast<double>(refSum))) {
+                assert(std::abs(serial.sum - static_cast<double>(refSum)) <= 1e-12 * std::abs(static_cast<double>(refSum)) + 1e-9);
+            } else if (std::isnan(refSum)) {
+                assert(std::isnan(serial.sum));
+            } else {
+                assert(serial.sum == static_cast<double>(refSum));
+            }
+
+            // Bit-identical whatever the thread count
+            for (unsigned threads : {1u, 2u, 3u}) {
+                ThreadPool pool(threads);
+                AggregateResult parallel = aggregate(*expr, columns, rows, policy, &pool);
+                assert(std::memcmp(&parallel.sum, &serial.sum, sizeof(double)) == 0);
+                assert(parallel.min == serial.min && parallel.max == serial.max);
+                assert(parallel.count == serial.count && parallel.errors == serial.errors);
+            }
+        }
+    }
+
+    // Compensation across chunks keeps small terms that a running sum would drop:
+    // the first chunk adds up to 2.56e17, the last one cancels it
+    const size_t termRows = 3 * AGGREGATE_BLOCK + 5 * BATCH_CHUNK;
+    std::vector<double> terms(termRows, 0.1);
+    std::fill(terms.begin(), terms.begin() + BATCH_CHUNK, 1e15);
+    std::fill(terms.end() - BATCH_CHUNK, terms.end(), -1e15);
+    BatchColumns termColumns{{"t", terms.data()}};
+    AggregateResult total = aggregate(*parseExpr("t"), termColumns, termRows);
+    assert(std::abs(total.sum - 0.1 * (termRows - 2 * BATCH_CHUNK)) < 1e-6);
+    assert(std::abs(total.mean() - total.sum / termRows) < 1e-12);
+
+    // A single infinite row makes the sum infinite with its sign, not NaN; both
+    // signs give NaN, as they would summed one by one
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<double> ones(10000, 1.0);
+    ones[4321] = 0.0;
+    BatchColumns oneColumns{{"x", ones.data()}};
+    assert(aggregate(*parseExpr("1 / x"), oneColumns, ones.size(), NumericPolicy::IEEE).sum == inf);
+    assert(aggregate(*parseExpr("-1 / x"), oneColumns, ones.size(), NumericPolicy::IEEE).sum == -inf);
+    ones[9000] = -0.0;
+    assert(std::isnan(aggregate(*parseExpr("1 / x"), oneColumns, ones.size(), NumericPolicy::IEEE).sum));
+    ones[9000] = 1.0;
+    assert(aggregate(*parseExpr("(x + 9) ** 400"), oneColumns, ones.size()).sum == inf);
+    // Finite rows whose running sum overflows
+    assert(aggregate(*parseExpr("x * 1e305"), oneColumns, ones.size()).sum == inf);
+
+    AggregateResult empty = aggregate(*parseExpr("t"), termColumns, 0);
+    assert(empty.count == 0 && empty.sum == 0 && std::isnan(empty.mean()));
+
+    std::cout << "Aggregate tests PASSED.\n";
+}
+
+void testServer() {
+    ServerOptions options;
+    options.socketPath = "/tmp/mini_expr_test_" + std::to_string(::getpid()) + ".sock";
+    options.threads = 2;
+    Server server(options);
+    server.listen();
+    std::thread loop([&] { server.run(); });
+
+    {
+        ServerClient a(options.socketPath);
+        ServerClient b(options.socketPath);
+
+        // Sessions are per connection
+        assert(a.eval("x = 6").value == 6);
+        assert(a.eval("x * 7").value == 42);
+        ServerReply missing = b.eval("x * 7");
+        assert(!missing.ok() && missing.error == "Undefined variable: x");
+
+        // Evaluation, parse and sandbox errors come back as messages
+        assert(b.eval("1 / 0").error == "Division by zero");
+        assert(!b.eval("1 +").ok());
+        assert(!b.eval(std::string(300, '(') + "1" + std::string(300, ')')).ok());
+        assert(b.eval("2 ** 10").value == 1024);
+
+        // Pipelined requests are answered in order
+        std::string frames;
+        for (int i = 0; i < 500; ++i) appendRequest(frames, ServerOp::Eval, "x = x + " + std::to_string(i));
+        a.send(frames);
+        double expected = 6;
+        for (int i = 0; i < 500; ++i) {
+            expected += i;
+            ServerReply r = a.receive();
+            assert(r.ok() && r.value == expected);
+        }
+
+        assert(a.reset().ok());
+        assert(!a.eval("x").ok());
+        a.send(static_cast<ServerOp>(9), "");
+        assert(a.receive().error == "Unknown opcode 9");
+    }
+
+    // A malformed frame closes only that connection
+    {
+        ServerClient bad(options.socketPath);
+        bad.send(std::string("\xff\xff\xff\x7f", 4));
+        bool closed = false;
+        try {
+            bad.receive();
+        } catch (const std::runtime_error&) {
+            closed = true;
+        }
+        assert(closed);
+        ServerClient good(options.socketPath);
+        assert(good.eval("1 + 1").value == 2);
+    }
+
+    server.stop();
+    loop.join();
+    assert(server.cachedFormulas() > 0);
+    std::cout << "Server tests PASSED.\n";
+}
+
+void testMetrics() {
+    Metrics::setEnabled(true);
+    Metrics::setSampleInterval(1);
+    Metrics::reset();
+
+    VarContext context{{"x", 4}};
+    auto expr = parseExpr("x * 2 + 1");  // 5 tokens + end, 5 nodes
+    MetricsSnapshot snap = Metrics::snapshot();
+    assert(snap.value(Counter::TokensLexed) == 6 && snap.value(Counter::NodesParsed) == 5);
+    for (int i = 0; i < 10; ++i) expr->tryEvaluate(context);
+    assert(parseExpr("1 / 0")->tryEvaluate(context).error == EvalError::DivisionByZero);
+    assert(parseExpr("x % 0")->tryEvaluate(context).error == EvalError::ModuloByZero);
+    testError("missing");
+
+    // Lex, parse and sandbox limit errors are counted by stage
+    bool threw = false;
+    try {
+        Lexer lexer("1 $ 2");
+        lexer.tokenize();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    threw = false;
+    try {
+        parseExpr("1 +");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    SandboxLimits limits;
+    limits.maxSteps = 100;
+    Sandbox sandbox(limits);
+    threw = false;
+    try {
+        sandbox.evaluate(std::string(200, '-') + "1", context);
+    } catch (const SandboxError&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Batch rows, and evaluations merged from another thread
+    std::vector<double> xs(1000, 1.0), out(1000);
+    std::vector<EvalError> errors(1000);
+    BatchColumns columns{{"x", xs.data()}};
+    expr->evaluateBatch(columns, xs.size(), out.data(), errors.data());
+    std::thread worker([&] {
+        VarContext local{{"x", 1}};
+        for (int i = 0; i < 5; ++i) expr->tryEvaluate(local);
+    });
+    worker.join();
+
+    snap = Metrics::snapshot();
+    assert(snap.value(Counter::Evaluations) == 10 + 2 + 1 + 1 + 5);
+    assert(snap.value(Counter::BatchRows) == 1000);
+    assert(snap.value(Counter::DivisionByZero) == 1 && snap.value(Counter::ModuloByZero) == 1);
+    assert(snap.value(Counter::UndefinedVariable) == 1 && snap.value(Counter::EvalLimitErrors) == 1);
+    assert(snap.value(Counter::LexErrors) == 1 && snap.value(Counter::ParseErrors) == 1);
+    assert(snap.latency(Stage::Evaluate).count == snap.value(Counter::Evaluations));
+    assert(snap.latency(Stage::Evaluate).quantileNanos(0.99) > 0);
+
+    std::string prom = Metrics::toPrometheus(snap);
+    assert(prom.find("miniexpr_evaluations_total 19\n") != std::string::npos);
+    assert(prom.find("miniexpr_errors_total{kind=\"division_by_zero\"} 1\n") != std::string::npos);
+    assert(prom.find("miniexpr_stage_latency_seconds_count{stage=\"evaluate\"} 19\n") != std::string::npos);
+    std::string json = Metrics::toJson(snap);
+    assert(json.find("\"evaluations\":19") != std::string::npos);
+    assert(json.find("\"eval_limit\":1") != std::string::npos);
+
+    // Sampling: one call in four is timed, every call is counted
+    Metrics::reset();
+    Metrics::setSampleInterval(4);
+    for (int i = 0; i < 400; ++i) expr->tryEvaluate(context);
+    snap = Metrics::snapshot();
+    assert(snap.value(Counter::Evaluations) == 400);
+    assert(snap.latency(Stage::Evaluate).count >= 99 && snap.latency(Stage::Evaluate).count <= 101);
+
+    // Counts stay exact across a reset in the middle of a sampling period
+    for (int i = 0; i < 3; ++i) expr->tryEvaluate(context);
+    Metrics::reset();
+    for (int i = 0; i < 6; ++i) expr->tryEvaluate(context);
+    assert(Metrics::snapshot().value(Counter::Evaluations) == 6);
+
+    // Tracing records every stage call
+    Metrics::startTrace();
+    parseExpr("x + 1")->tryEvaluate(context);
+    Metrics::stopTrace();
+    parseExpr("x + 2");
+    std::string trace = Metrics::traceJson();
+    assert(trace.rfind("{\"traceEvents\":[", 0) == 0);
+    for (const char* name : {"\"name\":\"lex\"", "\"name\":\"parse\"", "\"name\":\"evaluate\""}) {
+        size_t first = trace.find(name);
+        assert(first != std::string::npos && trace.find(name, first + 1) == std::string::npos);
+    }
+    assert(trace.find("\"dropped_events\":0") != std::string::npos);
+
+    // Disabled: nothing is counted
+    Metrics::setEnabled(false);
+    Metrics::reset();
+    expr->tryEvaluate(context);
+    parseExpr("1 / 0")->tryEvaluate(context);
+    snap = Metrics::snapshot();
+    assert(snap.value(Counter::Evaluations) == 0 && snap.value(Counter::DivisionByZero) == 0);
+    Metrics::setSampleInterval(256);
+
+    std::cout << "Metrics tests PASSED.\n";
+}
+
 int main() {
     VarContext context;
 
@@ -124,10 +972,38 @@ int main() {
     // Bitwise operations
     testBitwiseOperations();
 
+    // Number literals and formatting
+    testNumberFormatting();
+
+    // SIMD lexer against the scalar lexer
+    testLexerBackends();
+
+    // Parallel multi-statement loading
+    testLoader();
+
+    // Sandboxed evaluation budgets
+    testSandbox();
+
+    // Non-throwing evaluation
+    testErrorCodes();
+
+    // Comparisons, logic and conditionals
+    testConditionals();
+
+    // Fused batch reductions
+    testAggregate();
+
+    // Unix socket server mode
+    testServer();
+
+    // Counters, latency histograms and tracing
+    testMetrics();
+
     // Error handling tests
     testError("10 / 0");          // Division by zero
     testError("10 % 0");          // Modulo by zero
     testError("unknownVar + 5");  // Undefined variable
+    testError("1e999");           // Literal out of range
 
     std::cout << "All tests completed successfully.\n";
     return 0;